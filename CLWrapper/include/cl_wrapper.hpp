@@ -11,6 +11,21 @@
  */
 #pragma once
 
+#include "cl_wrapper/autotuner.hpp"
+#include "cl_wrapper/binary_cache.hpp"
+#include "cl_wrapper/buffer_pool.hpp"
+#include "cl_wrapper/device_array.hpp"
 #include "cl_wrapper/device_manager.hpp"
+#include "cl_wrapper/device_rating.hpp"
+#include "cl_wrapper/event.hpp"
+#include "cl_wrapper/host_backend.hpp"
+#include "cl_wrapper/image_format.hpp"
 #include "cl_wrapper/kernel_manager.hpp"
-#include "cl_wrapper/run.hpp"
\ No newline at end of file
+#include "cl_wrapper/multi_device.hpp"
+#include "cl_wrapper/profiler.hpp"
+#include "cl_wrapper/run.hpp"
+#include "cl_wrapper/stream_run.hpp"
+#include "cl_wrapper/svm.hpp"
+#include "cl_wrapper/task_graph.hpp"
+#include "cl_wrapper/tiled_run.hpp"
+#include "cl_wrapper/typed_kernel.hpp"
\ No newline at end of file
@@ -0,0 +1,157 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file autotuner.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Work-group size autotuning, with winners persisted on disk.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <CL/opencl.hpp>
+
+namespace clwrapper
+{
+
+// Tuning is done per kernel, device and problem size bucket (log2 of the
+// global size in each dimension). Winners are stored in a text file (one
+// 'key local_x [local_y]' entry per line, an empty local size meaning that
+// the choice is left to the driver) and are applied to later launches in
+// tuning mode. Only the kernels declared tunable are tuned, the others only
+// use the stored entries. With the tuning mode disabled, the local size is
+// left to the driver and the database is not even loaded.
+class Autotuner
+{
+public:
+  // Get the singleton instance
+  static Autotuner &get_instance()
+  {
+    static Autotuner instance;
+    return instance;
+  }
+
+  // remove the tuned entries, both in memory and on disk
+  void clear();
+
+  size_t get_entry_count() const;
+
+  std::string get_file_path() const;
+
+  // incremented each time the entries or the mode change, local sizes
+  // cached by the callers are only valid for a given generation
+  size_t get_generation() const
+  {
+    return this->generation;
+  }
+
+  // local size for a launch, empty if it is left to the driver. In tuning
+  // mode, unknown configurations of tunable kernels are tuned first (see
+  // set_tunable), without holding the lock: launches of a configuration
+  // being tuned by another thread are left to the driver
+  std::vector<size_t> get_local_size(const std::string            &kernel_name,
+                                     const cl::Kernel             &cl_kernel,
+                                     const cl::CommandQueue       &queue,
+                                     const std::vector<size_t>    &global_size,
+                                     const std::vector<cl::Event> &wait_list);
+
+  // tuning mode, also enabled with the CLWRAPPER_AUTOTUNE environment
+  // variable (lock-free, checked at each launch)
+  bool is_enabled() const
+  {
+    return this->enabled;
+  }
+
+  bool is_tunable(const std::string &kernel_name) const;
+
+  void set_enabled(bool new_state);
+
+  // tuning database (default to 'tuning.txt' in the binary cache directory
+  // or CLWRAPPER_TUNING_FILE if defined), entries are reloaded from the file
+  void set_file_path(const std::string &new_file_path);
+
+  // number of timed launches for each candidate
+  void set_repeats(int new_repeats);
+
+  // a tunable kernel is launched several times with its current arguments
+  // while tuned, it must therefore give the same result when run twice (no
+  // in-place accumulation)
+  void set_tunable(const std::string &kernel_name, bool new_state = true);
+
+  // round up each dimension of the global size to a multiple of the local
+  // size (or of a small power of two if the local size is empty)
+  static std::vector<size_t> pad_global_size(
+      const std::vector<size_t> &global_size,
+      const std::vector<size_t> &local_size);
+
+private:
+  // Private constructor
+  Autotuner();
+
+  // Delete copy constructor and assignment operator to enforce singleton
+  Autotuner(const Autotuner &) = delete;
+  Autotuner &operator=(const Autotuner &) = delete;
+
+  std::vector<std::vector<size_t>> get_candidates(
+      const cl::Kernel          &cl_kernel,
+      const cl::Device          &cl_device,
+      const std::vector<size_t> &global_size) const;
+
+  std::string get_device_signature(const cl::Device &cl_device);
+
+  std::string get_key(const std::string         &kernel_name,
+                      const cl::Device          &cl_device,
+                      const std::vector<size_t> &global_size);
+
+  void load();
+
+  void save() const;
+
+  // best time (ms) over the repeats, negative if the launch failed
+  float time_candidate(const cl::Kernel          &cl_kernel,
+                       const cl::CommandQueue    &queue,
+                       const std::vector<size_t> &global_size,
+                       const std::vector<size_t> &local_size,
+                       int                        repeats) const;
+
+  // called without the lock
+  std::vector<size_t> tune(const std::string         &kernel_name,
+                           const cl::Kernel          &cl_kernel,
+                           const cl::CommandQueue    &queue,
+                           const cl::Device          &cl_device,
+                           const std::vector<size_t> &global_size,
+                           int                        repeats) const;
+
+  std::map<std::string, std::vector<size_t>> entries;
+
+  std::map<cl_device_id, std::string> device_signatures;
+
+  std::set<std::string> tunable_kernels;
+
+  std::set<std::string> keys_in_tuning; // tuned by a thread
+
+  std::string file_path;
+
+  int repeats = 3;
+
+  std::atomic<bool> enabled{false};
+
+  std::atomic<size_t> generation{1};
+
+  bool is_loaded = false;
+
+  mutable std::mutex mutex;
+};
+
+// NullRange for an empty range
+cl::NDRange to_ndrange(const std::vector<size_t> &range);
+
+} // namespace clwrapper
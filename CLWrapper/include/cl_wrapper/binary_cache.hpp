@@ -0,0 +1,127 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file binary_cache.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief On-disk cache of OpenCL program binaries.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <CL/opencl.hpp>
+
+namespace clwrapper
+{
+
+enum BinaryType
+{
+  EXECUTABLE,     // built program (clBuildProgram / clLinkProgram)
+  COMPILED_OBJECT // compiled but not linked program (clCompileProgram)
+};
+
+struct BinaryCacheStats
+{
+  size_t hits = 0;
+  size_t misses = 0;
+  size_t stores = 0;
+  size_t corrupted = 0; // entries dropped because they could not be used
+};
+
+class BinaryCache
+{
+public:
+  // Get the singleton instance
+  static BinaryCache &get_instance()
+  {
+    static BinaryCache instance;
+    return instance;
+  }
+
+  // remove every cached binary from the cache directory
+  void clear();
+
+  // cache key, built from everything that affects the generated binary
+  // (sources, build options, device name/version and driver version)
+  std::string compute_key(
+      const std::string &sources,
+      const std::string &build_options,
+      const cl::Device  &cl_device,
+      BinaryType         type = BinaryType::EXECUTABLE) const;
+
+  std::string get_directory() const;
+
+  BinaryCacheStats get_stats() const;
+
+  bool is_enabled() const;
+
+  // remove an entry found to be unusable after loading (for instance a
+  // compiled object the linker rejects)
+  void invalidate(const cl::Device  &cl_device,
+                  const std::string &sources,
+                  const std::string &build_options,
+                  BinaryType         type = BinaryType::EXECUTABLE);
+
+  // try to create 'program' from a cached binary (and build it for
+  // executables), returns false on a miss or if the cached entry is
+  // unusable (it is then removed)
+  bool load_program(const cl::Context &cl_context,
+                    const cl::Device  &cl_device,
+                    const std::string &sources,
+                    const std::string &build_options,
+                    cl::Program       &program,
+                    BinaryType         type = BinaryType::EXECUTABLE);
+
+  void log_stats() const;
+
+  void reset_stats();
+
+  // setting a directory also enables the cache
+  void set_directory(const std::string &new_directory);
+
+  void set_enabled(bool new_state);
+
+  // store the binary of an already built (or compiled) program
+  bool store_program(const cl::Device  &cl_device,
+                     const std::string &sources,
+                     const std::string &build_options,
+                     const cl::Program &program,
+                     BinaryType         type = BinaryType::EXECUTABLE);
+
+private:
+  // Private constructor
+  BinaryCache();
+
+  // Delete copy constructor and assignment operator to enforce singleton
+  BinaryCache(const BinaryCache &) = delete;
+  BinaryCache &operator=(const BinaryCache &) = delete;
+
+  std::string get_entry_path(const std::string &key) const;
+
+  bool read_entry(const std::string &key, std::vector<unsigned char> &binary);
+
+  void remove_entry(const std::string &key);
+
+  bool write_entry(const std::string                &key,
+                   const std::vector<unsigned char> &binary);
+
+  std::string directory = "";
+
+  // disabled unless a directory is set, or the environment variable
+  // CLWRAPPER_CACHE_DIR is defined
+  bool enabled = false;
+
+  BinaryCacheStats stats;
+
+  mutable std::mutex mutex;
+};
+
+// FNV-1a 64 bits hash, used for cache keys and payload checksums
+uint64_t hash_fnv1a(const void *data, size_t size, uint64_t seed = 0);
+
+} // namespace clwrapper
@@ -0,0 +1,117 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file buffer_pool.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Pool of device buffers and images reused across Run instances.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include <CL/opencl.hpp>
+
+namespace clwrapper
+{
+
+struct BufferPoolStats
+{
+  size_t hits = 0;
+  size_t misses = 0;
+  size_t releases = 0;
+  size_t drops = 0; // released objects not kept (high-water mark reached)
+  size_t bytes_held = 0;
+  size_t objects_held = 0;
+};
+
+class BufferPool
+{
+public:
+  // Get the singleton instance
+  static BufferPool &get_instance()
+  {
+    static BufferPool instance;
+    return instance;
+  }
+
+  // get a buffer of at least 'size' bytes (its actual size is the size
+  // class of 'size')
+  cl::Buffer acquire_buffer(const cl::Context &cl_context,
+                            cl_mem_flags       flags,
+                            size_t             size,
+                            int               *p_err = nullptr);
+
+  // get an image with exactly the requested format and dimensions
+  cl::Image2D acquire_image2d(const cl::Context     &cl_context,
+                              cl_mem_flags           flags,
+                              const cl::ImageFormat &format,
+                              size_t                 width,
+                              size_t                 height,
+                              int                   *p_err = nullptr);
+
+  size_t get_high_water_mark() const;
+
+  BufferPoolStats get_stats() const;
+
+  bool is_enabled() const;
+
+  void log_stats() const;
+
+  // give back an object obtained from the pool, context, flags and size are
+  // retrieved from the object itself
+  void release(const cl::Buffer &buffer);
+
+  void release(const cl::Image2D &image);
+
+  void reset_stats();
+
+  void set_enabled(bool new_state);
+
+  // maximum amount of memory kept by the pool, objects released above this
+  // limit are freed
+  void set_high_water_mark(size_t new_high_water_mark);
+
+  // release pooled objects until at most 'target_bytes' are held
+  void trim(size_t target_bytes = 0);
+
+  // rounded up size actually allocated for a requested size (four classes
+  // per power of two, i.e. at most 25% overhead)
+  static size_t size_class(size_t size);
+
+private:
+  // Private constructor
+  BufferPool() = default;
+
+  // Delete copy constructor and assignment operator to enforce singleton
+  BufferPool(const BufferPool &) = delete;
+  BufferPool &operator=(const BufferPool &) = delete;
+
+  // returns true if an object of 'size' bytes can be kept
+  bool reserve(size_t size);
+
+  // context, flags, size class
+  using BufferKey = std::tuple<cl_context, cl_mem_flags, size_t>;
+
+  // context, flags, channel order, channel type, width, height
+  using ImageKey =
+      std::tuple<cl_context, cl_mem_flags, cl_uint, cl_uint, size_t, size_t>;
+
+  std::map<BufferKey, std::vector<cl::Buffer>> free_buffers;
+
+  std::map<ImageKey, std::vector<cl::Image2D>> free_images;
+
+  BufferPoolStats stats;
+
+  size_t high_water_mark = 512 * 1024 * 1024;
+
+  bool enabled = true;
+
+  mutable std::mutex mutex;
+};
+
+} // namespace clwrapper
@@ -0,0 +1,327 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file device_array.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Device-resident arrays and images, living across Run instances.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <vector>
+
+#include <CL/opencl.hpp>
+
+#include "cl_error_lookup.hpp"
+
+#include "cl_wrapper/buffer_pool.hpp"
+#include "cl_wrapper/kernel_manager.hpp"
+
+namespace clwrapper
+{
+
+// common interface used by Run to keep host and device copies coherent
+class DeviceResource
+{
+public:
+  virtual ~DeviceResource() = default;
+
+  // called by Run before a kernel launch, uploads host modifications
+  // without blocking on the Run queue. Returns the event of the last upload
+  // as long as it has not been waited for by the host (null otherwise), to
+  // be waited for by the kernel whatever its queue
+  virtual cl::Event sync_device(const cl::CommandQueue &queue) = 0;
+
+  // upload started by the last sync_device, null once waited for by the
+  // host
+  virtual cl::Event get_pending_upload() const = 0;
+
+  // called by Run after a kernel launch, the device copy may have changed
+  // once 'event' is complete (no-op for read-only resources)
+  virtual void mark_device_modified(const cl::Event &event) = 0;
+};
+
+// array stored on the device, only synchronized with its host copy when
+// explicitly asked or when the host copy is accessed. The array belongs to
+// the context of the given runtime (which must outlive it) and can only be
+// bound to Run instances of the same runtime
+template <typename T> class DeviceArray : public DeviceResource
+{
+public:
+  DeviceArray(size_t         size,
+              cl_mem_flags   flags = CL_MEM_READ_WRITE,
+              KernelManager &runtime = KernelManager::get_instance())
+      : host_data(size), flags(flags), p_runtime(&runtime)
+  {
+    this->allocate();
+  }
+
+  // host data are uploaded before the first kernel launch
+  DeviceArray(const std::vector<T> &vector,
+              cl_mem_flags          flags = CL_MEM_READ_WRITE,
+              KernelManager        &runtime = KernelManager::get_instance())
+      : host_data(vector), flags(flags), p_runtime(&runtime)
+  {
+    this->allocate();
+    this->is_host_modified = true;
+  }
+
+  DeviceArray(DeviceArray &&) = default;
+
+  ~DeviceArray()
+  {
+    this->wait_upload();
+    BufferPool::get_instance().release(this->cl_buffer);
+  }
+
+  DeviceArray(const DeviceArray &) = delete;
+  DeviceArray &operator=(const DeviceArray &) = delete;
+
+  // device to host copy (blocking), once the last kernel writing the array
+  // is complete
+  void download()
+  {
+    this->wait_upload();
+
+    std::vector<cl::Event> wait_list = this->get_write_wait_list();
+
+    int err = this->p_runtime->get_queue().enqueueReadBuffer(
+        this->cl_buffer,
+        CL_TRUE,
+        0,
+        this->size_bytes(),
+        this->host_data.data(),
+        wait_list.empty() ? nullptr : &wait_list);
+    clerror::throw_opencl_error(err);
+
+    this->is_device_modified = false;
+    this->last_write = cl::Event();
+  }
+
+  // host data, retrieved from the device if needed and flagged as modified
+  // (uploaded before the next kernel launch)
+  std::vector<T> &edit_host_data()
+  {
+    if (this->is_device_modified) this->download();
+    this->wait_upload();
+    this->is_host_modified = true;
+    return this->host_data;
+  }
+
+  cl::Buffer get_buffer() const
+  {
+    return this->cl_buffer;
+  }
+
+  cl_mem_flags get_flags() const
+  {
+    return this->flags;
+  }
+
+  // host data, retrieved from the device if needed
+  const std::vector<T> &get_host_data()
+  {
+    if (this->is_device_modified) this->download();
+    return this->host_data;
+  }
+
+  cl::Event get_pending_upload() const override
+  {
+    return this->pending_upload;
+  }
+
+  void mark_device_modified(const cl::Event &event) override
+  {
+    if (this->flags & CL_MEM_READ_ONLY) return;
+
+    this->is_device_modified = true;
+    this->last_write = event;
+  }
+
+  size_t size() const
+  {
+    return this->host_data.size();
+  }
+
+  size_t size_bytes() const
+  {
+    return sizeof(T) * this->host_data.size();
+  }
+
+  cl::Event sync_device(const cl::CommandQueue &queue) override
+  {
+    // uploaded by a previous launch, maybe not complete yet
+    if (!this->is_host_modified) return this->pending_upload;
+
+    // the host data must not change until the upload is complete (see
+    // edit_host_data)
+    std::vector<cl::Event> wait_list = this->get_write_wait_list();
+
+    int err = queue.enqueueWriteBuffer(this->cl_buffer,
+                                       CL_FALSE,
+                                       0,
+                                       this->size_bytes(),
+                                       this->host_data.data(),
+                                       wait_list.empty() ? nullptr : &wait_list,
+                                       &this->pending_upload);
+    clerror::throw_opencl_error(err);
+
+    this->is_host_modified = false;
+    return this->pending_upload;
+  }
+
+  // host to device copy (blocking)
+  void upload()
+  {
+    this->wait_upload();
+
+    std::vector<cl::Event> wait_list = this->get_write_wait_list();
+
+    int err = this->p_runtime->get_queue().enqueueWriteBuffer(
+        this->cl_buffer,
+        CL_TRUE,
+        0,
+        this->size_bytes(),
+        this->host_data.data(),
+        wait_list.empty() ? nullptr : &wait_list);
+    clerror::throw_opencl_error(err);
+
+    this->is_host_modified = false;
+  }
+
+private:
+  void allocate()
+  {
+    int err = CL_SUCCESS;
+    this->cl_buffer = BufferPool::get_instance().acquire_buffer(
+        this->p_runtime->get_context(),
+        this->flags,
+        this->size_bytes(),
+        &err);
+    clerror::throw_opencl_error(err);
+  }
+
+  void wait_upload()
+  {
+    if (!this->pending_upload()) return;
+
+    this->pending_upload.wait();
+    this->pending_upload = cl::Event();
+  }
+
+  // the last kernel writing the array may run on any queue
+  std::vector<cl::Event> get_write_wait_list() const
+  {
+    if (!this->last_write()) return {};
+    return {this->last_write};
+  }
+
+  std::vector<T> host_data;
+
+  cl::Buffer cl_buffer;
+
+  cl_mem_flags flags;
+
+  KernelManager *p_runtime; // not owned
+
+  // non-blocking upload started by sync_device
+  cl::Event pending_upload;
+
+  // last kernel launch writing the array
+  cl::Event last_write;
+
+  bool is_host_modified = false;
+
+  bool is_device_modified = false;
+};
+
+// single channel float 2D image stored on the device, same synchronization
+// and runtime rules as DeviceArray. Created read-write by default so that it
+// can be the output of a kernel and the input of the next one
+class DeviceImage : public DeviceResource
+{
+public:
+  DeviceImage(int            width,
+              int            height,
+              cl_mem_flags   flags = CL_MEM_READ_WRITE,
+              KernelManager &runtime = KernelManager::get_instance());
+
+  DeviceImage(const std::vector<float> &vector,
+              int                       width,
+              int                       height,
+              cl_mem_flags              flags = CL_MEM_READ_WRITE,
+              KernelManager &runtime = KernelManager::get_instance());
+
+  DeviceImage(DeviceImage &&) = default;
+
+  ~DeviceImage();
+
+  DeviceImage(const DeviceImage &) = delete;
+  DeviceImage &operator=(const DeviceImage &) = delete;
+
+  void download();
+
+  std::vector<float> &edit_host_data();
+
+  const std::vector<float> &get_host_data();
+
+  int get_height() const
+  {
+    return this->height;
+  }
+
+  cl::Image2D get_image() const
+  {
+    return this->cl_image;
+  }
+
+  cl::Event get_pending_upload() const override
+  {
+    return this->pending_upload;
+  }
+
+  int get_width() const
+  {
+    return this->width;
+  }
+
+  void mark_device_modified(const cl::Event &event) override;
+
+  cl::Event sync_device(const cl::CommandQueue &queue) override;
+
+  void upload();
+
+private:
+  void allocate();
+
+  void wait_upload();
+
+  // the last kernel writing the image may run on any queue
+  std::vector<cl::Event> get_write_wait_list() const;
+
+  std::vector<float> host_data;
+
+  cl::Image2D cl_image;
+
+  int width;
+
+  int height;
+
+  cl_mem_flags flags;
+
+  KernelManager *p_runtime; // not owned
+
+  // non-blocking upload started by sync_device
+  cl::Event pending_upload;
+
+  // last kernel launch writing the image
+  cl::Event last_write;
+
+  bool is_host_modified = false;
+
+  bool is_device_modified = false;
+};
+
+} // namespace clwrapper
@@ -0,0 +1,77 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file device_capabilities.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Device properties queried once, for schedulers and kernel
+ * specialization.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <string>
+#include <vector>
+
+#include <CL/opencl.hpp>
+
+namespace clwrapper
+{
+
+struct DeviceCapabilities
+{
+  std::string    name;
+  std::string    vendor;
+  std::string    version;          // e.g. 'OpenCL 3.0 CUDA'
+  std::string    opencl_c_version; // e.g. 'OpenCL C 1.2'
+  std::string    driver_version;
+  cl_device_type type = CL_DEVICE_TYPE_DEFAULT;
+
+  // compute
+  cl_uint             compute_units = 0;
+  cl_uint             clock_frequency = 0; // MHz
+  size_t              max_work_group_size = 0;
+  std::vector<size_t> max_work_item_sizes = {};
+
+  // memory (bytes)
+  cl_ulong global_mem_size = 0;
+  cl_ulong local_mem_size = 0;
+  cl_ulong max_mem_alloc_size = 0;
+  bool     unified_memory = false; // memory shared with the host
+
+  // images, limits are 0 without image support
+  bool   image_support = false;
+  size_t image2d_max_width = 0;
+  size_t image2d_max_height = 0;
+  size_t image3d_max_width = 0;
+  size_t image3d_max_height = 0;
+  size_t image3d_max_depth = 0;
+  size_t image_max_array_size = 0;
+
+  // extensions
+  std::string extensions;   // space separated
+  bool        fp16 = false; // cl_khr_fp16
+  bool        fp64 = false; // cl_khr_fp64
+
+  // CL_DEVICE_SVM_CAPABILITIES, 0 without SVM support (see svm.hpp)
+  cl_bitfield svm_capabilities = 0;
+
+  // preferred vector widths, 0 if the type is not supported
+  cl_uint preferred_vector_width_char = 0;
+  cl_uint preferred_vector_width_short = 0;
+  cl_uint preferred_vector_width_int = 0;
+  cl_uint preferred_vector_width_long = 0;
+  cl_uint preferred_vector_width_half = 0;
+  cl_uint preferred_vector_width_float = 0;
+  cl_uint preferred_vector_width_double = 0;
+
+  // OpenCL C version as 100 * major + 10 * minor, e.g. 120
+  int get_opencl_c_version() const;
+
+  bool has_extension(const std::string &extension) const;
+};
+
+DeviceCapabilities query_device_capabilities(const cl::Device &cl_device);
+
+} // namespace clwrapper
@@ -11,12 +11,32 @@
  */
 #pragma once
 #include <map>
+#include <mutex>
+#include <vector>
 
 #include <CL/opencl.hpp>
 
+#include "cl_wrapper/device_capabilities.hpp"
+#include "cl_wrapper/device_rating.hpp"
+
 namespace clwrapper
 {
 
+enum DeviceSelection
+{
+  HEURISTIC, // clock x compute units x vendor estimate of the cores per unit
+  BENCHMARK  // measured with probe kernels, ratings cached on disk
+};
+
+struct DeviceInfo
+{
+  size_t             platform_id;
+  size_t             device_index; // within the platform
+  std::string        name;         // 'platform vendor/platform name/device'
+  cl::Device         cl_device;
+  DeviceCapabilities capabilities;
+};
+
 class DeviceManager
 {
 public:
@@ -53,35 +73,72 @@ public:
     return DeviceManager::get_instance().get_device();
   }
 
-  // list all the available devices
+  // first device of each platform, by platform index (see get_devices for
+  // every device)
   std::map<size_t, std::string> get_available_devices();
 
+  // capabilities of the selected device
+  DeviceCapabilities get_capabilities() const;
+
   // Access the OpenCL device
   cl::Device get_device() const;
 
+  // platform index of the selected device
   size_t get_device_id() const
   {
+    std::lock_guard<std::mutex> lock(this->mutex);
     return this->device_id;
   }
 
-  bool set_device(size_t platform_id);
-
-  void set_device_type(cl_device_type new_device_type)
+  // index of the selected device within its platform
+  size_t get_device_index() const
   {
-    this->device_type = new_device_type;
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->device_index;
   }
 
+  // every (platform, device) pair of the allowed device type, with its
+  // capabilities. Devices are enumerated once
+  std::vector<DeviceInfo> get_devices();
+
+  // select the best device, returns false if no device is available.
+  // BENCHMARK rates every device of every platform, HEURISTIC (default) the
+  // first device of each platform, and is used if a device cannot be
+  // probed. The initial selection follows the CLWRAPPER_DEVICE_SELECTION
+  // ('benchmark') and CLWRAPPER_WORKLOAD ('compute', 'memory') environment
+  // variables. As with set_device, the programs need to be rebuilt for the
+  // new device
+  bool select_device(DeviceSelection selection,
+                     WorkloadProfile profile = WorkloadProfile::BALANCED);
+
+  bool set_device(size_t platform_id, size_t device_index = 0);
+
+  void set_device_type(cl_device_type new_device_type);
+
 private:
+  // the selected device may be changed by one thread while others read it
+  mutable std::mutex mutex;
+
   cl::Device cl_device;
 
   size_t device_id = 0;
 
+  size_t device_index = 0;
+
+  DeviceCapabilities capabilities;
+
+  std::vector<DeviceInfo> devices;
+
+  bool is_enumerated = false;
+
   // allowed device type (CL_DEVICE_TYPE_ALL | GPU | CPU)
   cl_device_type device_type = CL_DEVICE_TYPE_ALL;
 
   // Private constructor
   DeviceManager();
 
+  void assign_device(const DeviceInfo &info);
+
   // Delete copy constructor and assignment operator to enforce singleton
   DeviceManager(const DeviceManager &) = delete;
   DeviceManager &operator=(const DeviceManager &) = delete;
@@ -0,0 +1,96 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file device_rating.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Device ratings measured with probe kernels, persisted on disk.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <CL/opencl.hpp>
+
+namespace clwrapper
+{
+
+// kind of work the device is chosen for
+enum WorkloadProfile
+{
+  BALANCED,      // geometric mean of the bandwidth and the FLOPS
+  COMPUTE_BOUND, // FLOPS only
+  MEMORY_BOUND   // bandwidth only
+};
+
+struct DeviceRating
+{
+  float bandwidth = 0.f; // GB/s, device memory copy
+  float gflops = 0.f;    // single precision multiply-add
+
+  bool is_valid() const
+  {
+    return this->bandwidth > 0.f && this->gflops > 0.f;
+  }
+
+  float score(WorkloadProfile profile) const;
+};
+
+// Ratings are measured once per device, OpenCL version and driver version
+// with short bandwidth and FLOPS probe kernels (a few tens of milliseconds
+// per device) and stored in a text file (one 'signature bandwidth gflops'
+// entry per line).
+class DeviceRatings
+{
+public:
+  // Get the singleton instance
+  static DeviceRatings &get_instance()
+  {
+    static DeviceRatings instance;
+    return instance;
+  }
+
+  // remove the ratings, both in memory and on disk
+  void clear();
+
+  std::string get_file_path() const;
+
+  // cached rating, measured first if unknown. The rating is not valid if
+  // the probes failed on the device
+  DeviceRating get_rating(const cl::Device &cl_device);
+
+  // ratings file (default to 'ratings.txt' in the binary cache directory or
+  // CLWRAPPER_RATINGS_FILE if defined), entries are reloaded from the file
+  void set_file_path(const std::string &new_file_path);
+
+private:
+  // Private constructor
+  DeviceRatings();
+
+  // Delete copy constructor and assignment operator to enforce singleton
+  DeviceRatings(const DeviceRatings &) = delete;
+  DeviceRatings &operator=(const DeviceRatings &) = delete;
+
+  void load();
+
+  DeviceRating measure(const cl::Device &cl_device) const;
+
+  void save() const;
+
+  std::map<std::string, DeviceRating> entries;
+
+  std::string file_path;
+
+  bool is_loaded = false;
+
+  mutable std::mutex mutex;
+};
+
+// device name, OpenCL version and driver version hash
+std::string get_device_signature(const cl::Device &cl_device);
+
+} // namespace clwrapper
@@ -0,0 +1,48 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file dirty_ranges.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Byte ranges of host data modified since their last upload.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace clwrapper
+{
+
+// each transfer has a fixed cost, ranges closer than this (in bytes) are
+// uploaded as a single one
+static const size_t DIRTY_RANGE_MERGE_GAP = 4096;
+
+class DirtyRanges
+{
+public:
+  void add(size_t offset, size_t size);
+
+  void clear()
+  {
+    this->ranges.clear();
+  }
+
+  bool empty() const
+  {
+    return this->ranges.empty();
+  }
+
+  // sorted (offset, size) ranges, overlapping ones or ones separated by at
+  // most 'gap' bytes being merged
+  std::vector<std::pair<size_t, size_t>> coalesce(
+      size_t gap = DIRTY_RANGE_MERGE_GAP) const;
+
+private:
+  std::vector<std::pair<size_t, size_t>> ranges; // (offset, size)
+};
+
+} // namespace clwrapper
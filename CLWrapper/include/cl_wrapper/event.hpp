@@ -0,0 +1,85 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file event.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Handle on an enqueued OpenCL command (transfer or kernel launch).
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <functional>
+#include <vector>
+
+#include <CL/opencl.hpp>
+
+namespace clwrapper
+{
+
+// device timestamps (ns) of a command, only available for commands enqueued
+// on a profiling queue (see KernelManager::set_profiling)
+struct EventTiming
+{
+  cl_ulong queued = 0;
+  cl_ulong submit = 0;
+  cl_ulong start = 0;
+  cl_ulong end = 0;
+
+  // in ms
+  float get_execution_time() const
+  {
+    return (float)(this->end - this->start) * 1e-6f;
+  }
+
+  // in ms, time spent waiting in the queue
+  float get_queue_time() const
+  {
+    return (float)(this->start - this->queued) * 1e-6f;
+  }
+};
+
+class Event
+{
+public:
+  Event() = default;
+
+  explicit Event(const cl::Event &cl_event) : cl_event(cl_event)
+  {
+  }
+
+  cl::Event get_event() const
+  {
+    return this->cl_event;
+  }
+
+  // zeros if profiling information is not available
+  EventTiming get_timing() const;
+
+  bool is_complete() const;
+
+  // an empty event (command not enqueued) is always complete
+  bool is_valid() const
+  {
+    return this->cl_event() != nullptr;
+  }
+
+  // 'callback' is called once the command is complete, from a thread owned
+  // by the OpenCL runtime (it must not call blocking OpenCL functions)
+  Event &then(std::function<void()> callback);
+
+  // block until the command is complete
+  void wait() const;
+
+private:
+  cl::Event cl_event;
+};
+
+// OpenCL events of a wait list, empty events are skipped
+std::vector<cl::Event> to_cl_events(const std::vector<Event> &wait_list);
+
+// block until all the commands are complete
+void wait_for_events(const std::vector<Event> &events);
+
+} // namespace clwrapper
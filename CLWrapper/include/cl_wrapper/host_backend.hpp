@@ -0,0 +1,258 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file host_backend.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Native C++ kernels run on a work-stealing thread pool, used by Run
+ * when OpenCL is not available.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace clwrapper
+{
+
+// chunk sizes are rounded up to a multiple of this number of work-items so
+// that the chunks start on SIMD (and cache line) boundaries
+static const size_t HOST_CHUNK_MULTIPLE = 16;
+
+// default number of work-items per chunk
+static const size_t HOST_DEFAULT_CHUNK_SIZE = 4096;
+
+// Work-items of a host kernel call: global ids [begin, end) along x, on the
+// row y (0 for 1D ranges). Each call covers a contiguous chunk of a single
+// row, so that the inner loop can be vectorized by the compiler
+struct HostRange
+{
+  size_t                begin;
+  size_t                end;
+  size_t                y;
+  std::array<size_t, 2> global_size; // {n, 1} for 1D ranges
+};
+
+// kernel arguments, by position as for the OpenCL kernels: buffers and
+// images are given as pointers to the bound host data, scalars by value
+class HostArgs
+{
+public:
+  template <typename T> T *buffer(size_t index) const
+  {
+    const Arg &arg = this->get_arg(index);
+
+    if (!arg.ptr)
+      throw std::invalid_argument("host kernel argument " +
+                                  std::to_string(index) + " is not a buffer");
+
+    return static_cast<T *>(arg.ptr);
+  }
+
+  template <typename T> T value(size_t index) const
+  {
+    const Arg &arg = this->get_arg(index);
+
+    if (arg.ptr || arg.bytes.size() != sizeof(T))
+      throw std::invalid_argument("host kernel argument " +
+                                  std::to_string(index) +
+                                  " does not match the requested type");
+
+    T v;
+    std::memcpy(&v, arg.bytes.data(), sizeof(T));
+    return v;
+  }
+
+  // size in bytes of the bound data or value
+  size_t get_size(size_t index) const;
+
+  void set_pointer(size_t index, void *ptr, size_t size);
+
+  void set_value(size_t index, const void *ptr, size_t size);
+
+private:
+  struct Arg
+  {
+    void             *ptr = nullptr; // buffers
+    size_t            size = 0;
+    std::vector<char> bytes = {}; // scalars
+  };
+
+  const Arg &get_arg(size_t index) const;
+
+  Arg &get_or_create_arg(size_t index);
+
+  std::vector<Arg> args;
+};
+
+using HostKernel = std::function<void(const HostRange &range,
+                                      const HostArgs  &args)>;
+
+// Each worker owns a queue of tasks, initially filled with a contiguous
+// block of the task indices. Workers take their own tasks from the front
+// and, once done, steal the tasks left by the others from the back. The
+// calling thread takes part in the work. Calls are serialized and must not
+// be nested
+class ThreadPool
+{
+public:
+  // 'thread_count' includes the calling thread
+  explicit ThreadPool(size_t thread_count);
+
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  size_t get_thread_count() const
+  {
+    return this->queues.size();
+  }
+
+  // calls fct(k) for k in [0, task_count) and waits for the completion,
+  // the first exception thrown by a task is rethrown
+  void parallel_for(size_t task_count, const std::function<void(size_t)> &fct);
+
+private:
+  struct WorkQueue
+  {
+    std::mutex         mutex;
+    std::deque<size_t> tasks;
+  };
+
+  // runs a single task, false if there is none left
+  bool run_task(size_t queue_index);
+
+  void worker_loop(size_t queue_index);
+
+  std::vector<std::thread> threads;
+
+  // one per worker, the last one for the calling thread
+  std::vector<std::unique_ptr<WorkQueue>> queues;
+
+  const std::function<void(size_t)> *p_fct = nullptr;
+
+  std::atomic<size_t> remaining{0};
+
+  std::exception_ptr exception;
+
+  std::mutex exception_mutex;
+
+  std::mutex mutex;
+
+  std::condition_variable cv_work;
+
+  std::condition_variable cv_done;
+
+  size_t generation = 0;
+
+  bool is_stopping = false;
+
+  std::mutex call_mutex;
+};
+
+// Registry of the host kernels. A Run uses the host kernel with the same
+// name if OpenCL is not available (no platform or device) or if the host
+// backend is forced, e.g. to compare the OpenCL and native throughputs
+class HostBackend
+{
+public:
+  // Get the singleton instance
+  static HostBackend &get_instance()
+  {
+    static HostBackend instance;
+    return instance;
+  }
+
+  // kernel called for chunks of work-items
+  void add_kernel(const std::string &kernel_name, HostKernel kernel);
+
+  // kernel called for each work-item, 'fct(i, args)' for 1D ranges or
+  // 'fct(x, y, args)' for 2D ranges
+  template <typename F>
+  void add_kernel_per_item(const std::string &kernel_name, F fct)
+  {
+    this->add_kernel(kernel_name,
+                     [fct](const HostRange &range, const HostArgs &args)
+                     {
+                       for (size_t i = range.begin; i < range.end; i++)
+                         if constexpr (std::is_invocable_v<F,
+                                                           size_t,
+                                                           size_t,
+                                                           const HostArgs &>)
+                           fct(i, range.y, args);
+                         else
+                           fct(i, args);
+                     });
+  }
+
+  // run the kernel on the global range (1D or 2D) and wait for it
+  void execute(const std::string         &kernel_name,
+               const std::vector<size_t> &global_size,
+               const HostArgs            &args);
+
+  size_t get_chunk_size() const;
+
+  size_t get_thread_count() const;
+
+  bool has_kernel(const std::string &kernel_name) const;
+
+  // set with the CLWRAPPER_HOST_BACKEND environment variable
+  bool is_forced() const;
+
+  // true if a Run of this kernel executes on the host
+  bool is_used(const std::string &kernel_name);
+
+  // rounded up to a multiple of HOST_CHUNK_MULTIPLE
+  void set_chunk_size(size_t new_chunk_size);
+
+  void set_forced(bool new_state);
+
+  // default to the number of hardware threads or CLWRAPPER_HOST_THREADS if
+  // defined
+  void set_thread_count(size_t new_thread_count);
+
+private:
+  // Private constructor
+  HostBackend();
+
+  // Delete copy constructor and assignment operator to enforce singleton
+  HostBackend(const HostBackend &) = delete;
+  HostBackend &operator=(const HostBackend &) = delete;
+
+  std::map<std::string, HostKernel> kernels;
+
+  // created at the first execution, kept alive by the running executions
+  // when the thread count changes
+  std::shared_ptr<ThreadPool> pool;
+
+  size_t thread_count;
+
+  size_t chunk_size = HOST_DEFAULT_CHUNK_SIZE;
+
+  bool forced = false;
+
+  // OpenCL availability, checked once
+  bool is_opencl_checked = false;
+
+  bool is_opencl_available = false;
+
+  mutable std::mutex mutex;
+};
+
+} // namespace clwrapper
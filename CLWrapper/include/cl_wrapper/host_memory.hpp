@@ -0,0 +1,97 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file host_memory.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Host allocations suitable for zero-copy buffers.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+namespace clwrapper
+{
+
+// alignment (and size granularity) of the host allocations that can be
+// shared with the device without any copy (page size)
+static const size_t HOST_PTR_ALIGNMENT = 4096;
+
+enum ZeroCopyMode
+{
+  AUTO,   // zero-copy for aligned host data if the device shares the host
+          // memory, copies otherwise
+  ALWAYS, // zero-copy for aligned host data, even on discrete devices, and
+          // host accessible buffers otherwise
+  NEVER   // explicit copies to device buffers
+};
+
+// how a Run buffer is backed
+enum BufferMode
+{
+  COPY,       // device buffer, host data copied by read / write
+  ZERO_COPY,  // host data used in place (CL_MEM_USE_HOST_PTR)
+  PINNED,     // host accessible buffer (CL_MEM_ALLOC_HOST_PTR), copied
+  SVM_COARSE, // coarse-grained SVM allocation, map / unmap
+  SVM_FINE,   // fine-grained SVM allocation, shared without synchronization
+  HOST        // host backend, data used in place by the host kernel
+};
+
+inline bool is_svm_mode(BufferMode mode)
+{
+  return mode == BufferMode::SVM_COARSE || mode == BufferMode::SVM_FINE;
+}
+
+template <typename T> struct AlignedAllocator
+{
+  using value_type = T;
+
+  AlignedAllocator() = default;
+
+  template <typename U> AlignedAllocator(const AlignedAllocator<U> &)
+  {
+  }
+
+  T *allocate(size_t n)
+  {
+    // aligned_alloc requires a size multiple of the alignment
+    size_t size = ((n * sizeof(T) + HOST_PTR_ALIGNMENT - 1) /
+                   HOST_PTR_ALIGNMENT) *
+                  HOST_PTR_ALIGNMENT;
+
+    void *p = std::aligned_alloc(HOST_PTR_ALIGNMENT, size);
+    if (!p) throw std::bad_alloc();
+
+    return static_cast<T *>(p);
+  }
+
+  void deallocate(T *p, size_t)
+  {
+    std::free(p);
+  }
+
+  template <typename U> bool operator==(const AlignedAllocator<U> &) const
+  {
+    return true;
+  }
+
+  template <typename U> bool operator!=(const AlignedAllocator<U> &) const
+  {
+    return false;
+  }
+};
+
+// host vector that can be bound to a Run without any copy in zero-copy mode
+template <typename T> using HostVector = std::vector<T, AlignedAllocator<T>>;
+
+inline bool is_host_ptr_aligned(const void *ptr)
+{
+  return ptr && reinterpret_cast<uintptr_t>(ptr) % HOST_PTR_ALIGNMENT == 0;
+}
+
+} // namespace clwrapper
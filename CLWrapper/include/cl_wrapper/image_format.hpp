@@ -0,0 +1,73 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file image_format.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Image formats: host types, channel sizes and device support.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <cstdint>
+
+#include <CL/opencl.hpp>
+
+namespace clwrapper
+{
+
+// default channel data type for a host value type. Integer types map to
+// normalized formats (read with read_imagef), the unnormalized ones
+// (CL_UNSIGNED_INT16...) or CL_HALF_FLOAT (with cl_half, i.e. uint16_t) need
+// to be requested explicitly
+template <typename T> struct ImageFormatTraits;
+
+template <> struct ImageFormatTraits<float>
+{
+  static constexpr cl_channel_type channel_type = CL_FLOAT;
+};
+
+template <> struct ImageFormatTraits<uint8_t>
+{
+  static constexpr cl_channel_type channel_type = CL_UNORM_INT8;
+};
+
+template <> struct ImageFormatTraits<int8_t>
+{
+  static constexpr cl_channel_type channel_type = CL_SNORM_INT8;
+};
+
+template <> struct ImageFormatTraits<uint16_t>
+{
+  static constexpr cl_channel_type channel_type = CL_UNORM_INT16;
+};
+
+template <> struct ImageFormatTraits<int16_t>
+{
+  static constexpr cl_channel_type channel_type = CL_SNORM_INT16;
+};
+
+template <> struct ImageFormatTraits<uint32_t>
+{
+  static constexpr cl_channel_type channel_type = CL_UNSIGNED_INT32;
+};
+
+template <> struct ImageFormatTraits<int32_t>
+{
+  static constexpr cl_channel_type channel_type = CL_SIGNED_INT32;
+};
+
+// 0 if unknown
+size_t channel_count(cl_channel_order order);
+
+// size in bytes of one channel value, 0 if unknown
+size_t channel_type_size(cl_channel_type type);
+
+// checked against getSupportedImageFormats (results are cached)
+bool is_image_format_supported(const cl::Context     &context,
+                               cl_mem_flags           flags,
+                               cl_mem_object_type     type,
+                               const cl::ImageFormat &format);
+
+} // namespace clwrapper
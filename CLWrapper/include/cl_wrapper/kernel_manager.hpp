@@ -10,11 +10,87 @@
  * @copyright Copyright (c) 2025
  */
 #pragma once
+#include <future>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
 #include <CL/opencl.hpp>
 
+#include "cl_wrapper/host_memory.hpp"
+
 namespace clwrapper
 {
 
+// each source added to the KernelManager is a module, compiled once on its
+// own (clCompileProgram) and linked (clLinkProgram) into its own executable
+// program. Helpers shared by several modules go in the kernel headers (see
+// KernelManager::add_kernel_header), compiled in front of every module
+struct Module
+{
+  std::string sources;
+
+  cl::Program cl_object; // compiled object
+
+  cl::Program cl_program; // linked executable
+
+  std::vector<std::string> kernel_names;
+
+  bool is_built = false;
+
+  // set while the module is built in the background
+  std::shared_future<void> pending_build;
+};
+
+// reusable kernel objects for a given kernel name
+struct KernelPool
+{
+  cl::Program cl_program; // program the kernels have been created from
+
+  std::vector<cl::Kernel> kernels;
+};
+
+// thrown when a module fails to compile or link, holds the compiler output
+class BuildError : public std::runtime_error
+{
+public:
+  BuildError(const std::string &message, const std::string &build_log, int err)
+      : std::runtime_error(message + "\n" + build_log), build_log(build_log),
+        err(err)
+  {
+  }
+
+  const std::string &get_build_log() const
+  {
+    return this->build_log;
+  }
+
+  int get_error_code() const
+  {
+    return this->err;
+  }
+
+private:
+  std::string build_log;
+
+  int err;
+};
+
+// compile (or load from the binary cache) and link the sources of a module
+// for a given device
+void helper_build_module(const cl::Context &cl_context,
+                         const cl::Device  &cl_device,
+                         const std::string &sources,
+                         const std::string &build_options,
+                         bool               use_cache,
+                         cl::Program       &cl_object,
+                         cl::Program       &cl_program);
+
+// A KernelManager holds a device, its context, the modules built for it and
+// the queue shared by the Run instances using it. The singleton instance is
+// the default runtime and follows the device selected by the DeviceManager.
+// Other instances are bound to a fixed device and are independent from each
+// other: they can be created per thread or per device and used concurrently
 class KernelManager
 {
 public:
@@ -25,6 +101,15 @@ public:
     return instance;
   }
 
+  // runtime bound to a given device, the context is created right away
+  explicit KernelManager(const cl::Device &device);
+
+  // wait for the background builds before the modules are released
+  ~KernelManager();
+
+  KernelManager(const KernelManager &) = delete;
+  KernelManager &operator=(const KernelManager &) = delete;
+
   // Get the OpenCL context attached to the singleton instance
   static cl::Context context()
   {
@@ -36,43 +121,209 @@ public:
     return KernelManager::get_instance().get_program();
   }
 
+  // Get the program holding the kernel 'kernel_name'
+  static cl::Program program(const std::string &kernel_name)
+  {
+    return KernelManager::get_instance().get_program(kernel_name);
+  }
+
+  // Get the command queue shared by all the Run instances
+  static cl::CommandQueue queue()
+  {
+    return KernelManager::get_instance().get_queue();
+  }
+
+  // register a new module and build it (unless in lazy build mode),
+  // already built modules are not recompiled
   void add_kernel(const std::string &kernel_sources,
                   bool               clear_sources = false);
 
+  // sources shared by every module (helper functions, macros, types),
+  // compiled in front of each of them. Helper functions should be declared
+  // 'static' so that the modules can still be linked together (see
+  // get_program). The modules are rebuilt at the next build
+  void add_kernel_header(const std::string &header_sources);
+
+  // build every module not yet built for the current device (in lazy build
+  // mode, only the context is updated and modules are built on first use).
+  // A module failing to build does not prevent the others from being
+  // built, the first error (BuildError) is rethrown afterwards
   void build_program();
 
-  void clear_sources()
+  // same as build_program but the modules are built in a background thread.
+  // Build errors (BuildError) are rethrown by the future's get(). A Run only
+  // waits for the build if its own kernel is not ready yet
+  std::shared_future<void> build_program_async();
+
+  // take a kernel object from the pool (created if the pool is empty), the
+  // kernel is owned by the caller until it is released. Arguments are not
+  // reset, a pooled kernel keeps the ones set by its previous owner
+  cl::Kernel checkout_kernel(const std::string &kernel_name);
+
+  // remove the modules and the kernel headers
+  void clear_sources();
+
+  // context of the runtime, created for the current device if it does not
+  // exist yet (the default instance only creates it at the first build)
+  cl::Context ensure_context();
+
+  std::string get_build_options() const
   {
-    this->full_sources = "";
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    return this->build_options;
   }
 
   cl::Context get_context() const
   {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
     return this->cl_context;
   }
 
-  cl::Program get_program() const
+  std::vector<std::string> get_kernel_names() const;
+
+  // sources of the module holding the kernel (empty if unknown)
+  std::string get_kernel_sources(const std::string &kernel_name) const;
+
+  size_t get_module_count() const
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    return this->modules.size();
+  }
+
+  // all the modules linked together into one program (linked on demand)
+  cl::Program get_program();
+
+  // in lazy build mode, the module holding the kernel is built if needed.
+  // Throws std::invalid_argument if no module defines the kernel
+  cl::Program get_program(const std::string &kernel_name);
+
+  cl::CommandQueue get_queue() const
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    return this->cl_queue;
+  }
+
+  // device of the context (null until the first build for the default
+  // instance)
+  cl::Device get_device() const
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    return this->cl_device;
+  }
+
+  bool is_lazy_build() const
   {
-    return this->cl_program;
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    return this->lazy_build;
   }
 
+  // true if buffers bound to host data should share it with the device
+  // (see set_zero_copy_mode)
+  bool is_zero_copy() const;
+
+  ZeroCopyMode get_zero_copy_mode() const
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    return this->zero_copy_mode;
+  }
+
+  bool is_profiling() const
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    return this->profiling;
+  }
+
+  // give back a kernel object obtained with checkout_kernel (dropped if its
+  // program has been rebuilt in the meantime)
+  void release_kernel(const std::string &kernel_name, const cl::Kernel &kernel);
+
   void set_build_options(const std::string &new_build_options);
 
+  // when enabled, sources are only recorded by add_kernel and each module is
+  // built the first time one of its kernels is requested
+  void set_lazy_build(bool new_state)
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    this->lazy_build = new_state;
+  }
+
+  // when enabled, the shared queue is created with CL_QUEUE_PROFILING_ENABLE
+  // and kernel execution times are recorded by the KernelProfiler (only
+  // for Run instances created afterwards)
+  void set_profiling(bool new_state);
+
+  // AUTO (default) enables zero-copy buffers for page-aligned host data on
+  // devices sharing the host memory (CL_DEVICE_HOST_UNIFIED_MEMORY), only for
+  // Run instances created afterwards
+  void set_zero_copy_mode(ZeroCopyMode new_mode)
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    this->zero_copy_mode = new_mode;
+  }
+
+  // build upfront the modules holding the given kernels (meant for latency
+  // critical kernels in lazy build mode)
+  void warm_up(const std::vector<std::string> &kernel_names);
+
 private:
-  // Private constructor
+  // Private constructor, default instance
   KernelManager();
 
-  // Delete copy constructor and assignment operator to enforce singleton
-  KernelManager(const KernelManager &) = delete;
-  KernelManager &operator=(const KernelManager &) = delete;
+  // compilation and linking are done without holding the lock
+  void build_module(size_t module_index);
+
+  void create_queue();
+
+  // create the context if the device has changed and mark the modules for
+  // rebuild if so
+  void update_context();
+
+  // wait for the background build of a module, if any (errors are only
+  // rethrown if the module could not be built)
+  void wait_module_build(size_t module_index);
+
+  mutable std::recursive_mutex mutex;
 
   cl::Program cl_program;
 
   cl::Context cl_context;
 
-  std::string full_sources = "";
+  // device the context has been created for
+  cl::Device cl_device;
+
+  // set for the instances bound to a device (null for the default one)
+  cl::Device fixed_device;
+
+  cl::CommandQueue cl_queue;
+
+  std::map<std::string, KernelPool> kernel_pools;
+
+  std::vector<Module> modules;
+
+  std::map<std::string, size_t> kernel_to_module;
+
+  // incremented each time the modules are cleared, to discard the results
+  // of builds started before
+  size_t generation = 0;
+
+  bool is_program_linked = false;
+
+  bool lazy_build = false;
+
+  bool profiling = false;
+
+  ZeroCopyMode zero_copy_mode = ZeroCopyMode::AUTO;
+
+  // device property, updated with the context
+  bool host_unified_memory = false;
 
   std::string build_options = "";
+
+  // kernel headers, in front of the sources of every module
+  std::string header_sources = "";
 };
 
+// explicit runtime objects, see KernelManager
+using Runtime = KernelManager;
+
 } // namespace clwrapper
@@ -0,0 +1,180 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file multi_device.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Execution of one NDRange split across several OpenCL devices.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <map>
+#include <mutex>
+
+#include <CL/opencl.hpp>
+
+#include "cl_error_lookup.hpp"
+
+#include "cl_wrapper/buffer_pool.hpp"
+#include "cl_wrapper/run.hpp"
+
+namespace clwrapper
+{
+
+// devices may belong to different platforms, each one has its own context,
+// queue (with profiling enabled) and programs
+struct DeviceSlot
+{
+  cl::Device cl_device;
+
+  cl::Context cl_context;
+
+  cl::CommandQueue cl_queue;
+
+  std::map<std::string, cl::Program> programs; // by module sources
+
+  std::map<std::string, float> throughputs; // elements / ms, by kernel name
+};
+
+class MultiDeviceManager
+{
+public:
+  // Get the singleton instance
+  static MultiDeviceManager &get_instance()
+  {
+    static MultiDeviceManager instance;
+    return instance;
+  }
+
+  // kernel object for a given device, the module holding the kernel (known
+  // by the KernelManager) is built for the device if needed
+  cl::Kernel create_kernel(size_t device_index, const std::string &kernel_name);
+
+  cl::Context get_context(size_t device_index) const;
+
+  size_t get_device_count() const;
+
+  std::vector<cl::Device> get_devices() const;
+
+  cl::CommandQueue get_queue(size_t device_index) const;
+
+  // share of the work of each device (sum is 1), proportional to the
+  // throughput measured during the previous runs. Devices not measured yet
+  // use a compute units x clock estimate, scaled to the measured ones
+  std::vector<float> get_weights(const std::string &kernel_name) const;
+
+  // exponential moving average of the throughput
+  void record_throughput(size_t             device_index,
+                         const std::string &kernel_name,
+                         float              throughput);
+
+  // devices used (default to all the available devices of all platforms)
+  void set_devices(const std::vector<cl::Device> &devices);
+
+  // weight of the last measurement in the moving average (in ]0, 1])
+  void set_smoothing(float new_smoothing);
+
+private:
+  // Private constructor
+  MultiDeviceManager();
+
+  // Delete copy constructor and assignment operator to enforce singleton
+  MultiDeviceManager(const MultiDeviceManager &) = delete;
+  MultiDeviceManager &operator=(const MultiDeviceManager &) = delete;
+
+  std::vector<DeviceSlot> slots;
+
+  float smoothing = 0.5f;
+
+  mutable std::mutex mutex;
+};
+
+// Partitioned buffers are split along their last dimension (elements in 1D,
+// rows in 2D), each device working on a contiguous slice with a global
+// offset: kernels are written as for a single device. Every device holds a
+// full-size copy, inputs are only uploaded for the slice plus the halo and
+// outputs are merged back from the slices. Buffers that are not partitioned
+// are uploaded entirely (inputs) or read from the first device (outputs).
+// The size of a partitioned buffer must be a multiple of the number of
+// elements (1D) or rows (2D), execute throws std::invalid_argument otherwise
+class MultiDeviceRun
+{
+public:
+  MultiDeviceRun(const std::string &kernel_name);
+
+  ~MultiDeviceRun();
+
+  MultiDeviceRun(const MultiDeviceRun &) = delete;
+  MultiDeviceRun &operator=(const MultiDeviceRun &) = delete;
+
+  template <typename T> void bind_arguments(T arg)
+  {
+    for (auto &kernel : this->kernels)
+    {
+      err = kernel.setArg(this->arg_count, arg);
+      clerror::throw_opencl_error(err);
+    }
+    this->arg_count++;
+  }
+
+  template <typename... Args> void bind_arguments(Args... args)
+  {
+    (this->bind_arguments(args), ...);
+  }
+
+  template <typename T>
+  void bind_buffer(const std::string &id,
+                   std::vector<T>    &vector,
+                   Direction          direction,
+                   bool               is_partitioned = true)
+  {
+    this->bind_buffer_impl(id,
+                           static_cast<void *>(vector.data()),
+                           vector_sizeof<T>(vector),
+                           direction,
+                           is_partitioned);
+  }
+
+  // 'halo' elements (1D) or rows (2D) around each slice are also uploaded
+  void execute(int total_elements, int halo = 0);
+
+  void execute(const std::vector<int> &global_range_2d, int halo = 0);
+
+  size_t get_device_count() const
+  {
+    return this->kernels.size();
+  }
+
+private:
+  struct PartitionedBuffer
+  {
+    std::vector<cl::Buffer> cl_buffers; // one per device
+    void                   *vector_ref;
+    size_t                  size;
+    Direction               direction;
+    bool                    is_partitioned;
+  };
+
+  void bind_buffer_impl(const std::string &id,
+                        void              *vector_ref,
+                        size_t             size,
+                        Direction          direction,
+                        bool               is_partitioned);
+
+  // 'units' elements or rows of 'unit_width' elements
+  void execute_partitioned(int units, int unit_width, int halo, bool is_2d);
+
+  std::string kernel_name;
+
+  std::vector<cl::Kernel> kernels; // one per device
+
+  std::map<std::string, PartitionedBuffer> buffers;
+
+  int arg_count = 0;
+
+  int err = 0;
+};
+
+} // namespace clwrapper
@@ -0,0 +1,103 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file profiler.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Registry of kernel execution times measured with OpenCL profiling
+ * events.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cl_wrapper/event.hpp"
+
+namespace clwrapper
+{
+
+// all durations in milliseconds
+struct KernelStats
+{
+  size_t count = 0;
+  float  min = 0.f;
+  float  max = 0.f;
+  float  mean = 0.f;
+  float  p50 = 0.f; // percentiles are computed on the newest samples only
+  float  p99 = 0.f;
+  float  total = 0.f;
+};
+
+class KernelProfiler
+{
+public:
+  // Get the singleton instance
+  static KernelProfiler &get_instance()
+  {
+    static KernelProfiler instance;
+    return instance;
+  }
+
+  std::map<std::string, KernelStats> get_all_stats() const;
+
+  // blocking launches (Run::execute) are recorded before they return, the
+  // others once complete (see flush)
+  KernelStats get_stats(const std::string &kernel_name) const;
+
+  // wait until the launches already submitted for recording on completion
+  // have been recorded (their queues are flushed)
+  void flush();
+
+  void log_stats() const;
+
+  // record the execution time (start to end) of a kernel launch
+  void record(const std::string &kernel_name, const EventTiming &timing);
+
+  // record the launch once its event is complete, from the OpenCL callback
+  void record_on_completion(const std::string &kernel_name,
+                            const Event       &event);
+
+  void reset();
+
+  // number of samples kept per kernel for the percentiles, the newest ones
+  // are kept when the window is resized
+  void set_window_size(size_t new_window_size);
+
+private:
+  // Private constructor
+  KernelProfiler() = default;
+
+  // Delete copy constructor and assignment operator to enforce singleton
+  KernelProfiler(const KernelProfiler &) = delete;
+  KernelProfiler &operator=(const KernelProfiler &) = delete;
+
+  // ring buffer of the newest samples, 'head' is the oldest one
+  struct Samples
+  {
+    KernelStats        stats; // count, min, max and total
+    std::vector<float> window;
+    size_t             head = 0;
+    size_t             count = 0;
+  };
+
+  KernelStats compute_stats(const Samples &samples) const;
+
+  std::map<std::string, Samples> samples;
+
+  size_t window_size = 1024;
+
+  // launches to be recorded once complete
+  std::vector<Event> pending_events;
+
+  std::condition_variable cv_pending;
+
+  mutable std::mutex mutex;
+};
+
+} // namespace clwrapper
@@ -10,58 +10,122 @@
  * @copyright Copyright (c) 2025
  */
 #pragma once
+#include <array>
+#include <chrono>
 #include <map>
 
 #include <CL/opencl.hpp>
 
 #include "cl_error_lookup.hpp"
 
+#include "cl_wrapper/buffer_pool.hpp"
+#include "cl_wrapper/device_array.hpp"
+#include "cl_wrapper/dirty_ranges.hpp"
+#include "cl_wrapper/event.hpp"
+#include "cl_wrapper/host_backend.hpp"
+#include "cl_wrapper/host_memory.hpp"
+#include "cl_wrapper/image_format.hpp"
+#include "cl_wrapper/kernel_manager.hpp"
+#include "cl_wrapper/svm.hpp"
+
 namespace clwrapper
 {
 
 // helper
-template <typename T> size_t vector_sizeof(const typename std::vector<T> &v)
+template <typename T, typename A = std::allocator<T>>
+size_t vector_sizeof(const typename std::vector<T, A> &v)
 {
   return sizeof(T) * v.size();
 }
 
+enum Direction
+{
+  IN,
+  OUT
+};
+
 struct Buffer
 {
-  cl::Buffer cl_buffer;
-  void      *vector_ref;
-  size_t     size;
+  std::string  id;
+  cl::Buffer   cl_buffer;
+  void        *vector_ref;
+  size_t       size;
+  cl_mem_flags flags;
+  int          arg_index;
+  BufferMode   mode = BufferMode::COPY;
+  bool         is_mapped = false; // zero-copy buffer owned by the host
+  DirtyRanges  dirty_ranges;      // host ranges to upload before the launch
 };
 
-struct Image2D
+struct Image
 {
-  cl::Image2D cl_image;
-  void       *vector_ref;
-  int         width;
-  int         height;
+  std::string        id;
+  cl::Image          cl_image;
+  void              *vector_ref;
+  int                width;
+  int                height;
+  int                depth = 1; // depth (3D) or number of layers (2D array)
+  cl_mem_object_type type = CL_MEM_OBJECT_IMAGE2D;
+  cl::ImageFormat    format;
+  Direction          direction;
+  int                arg_index;
 };
 
-enum Direction
+static const size_t INVALID_HANDLE = (size_t)-1;
+
+// handles returned by the Run bind methods, to access buffers and images
+// without any id lookup. Binding an id again keeps its handle
+struct BufferHandle
 {
-  IN,
-  OUT
+  size_t index = INVALID_HANDLE;
+};
+
+struct ImageHandle
+{
+  size_t index = INVALID_HANDLE;
 };
 
 // class
 class Run
 {
 public:
+  // the kernel object is taken from the KernelManager pool and the command
+  // queue is shared, construction does not create any OpenCL object. The
+  // host kernel of the same name is used instead if OpenCL is not available
+  // or if the host backend is forced (see HostBackend): buffers and images
+  // are then used in place, transfers do nothing and execution is blocking.
+  // A pooled kernel object keeps the arguments set by the previous Run
+  // using it, every argument of the kernel must be bound (or set) again
   Run(const std::string &kernel_name);
 
+  // kernel, context and queue taken from a given runtime instead of the
+  // default one (the runtime must outlive the Run)
+  Run(const std::string &kernel_name, KernelManager &runtime);
+
+  // the moved-from Run no longer holds any kernel, buffer or pending
+  // command
+  Run(Run &&other);
+
+  Run &operator=(Run &&other);
+
   ~Run();
 
+  Run(const Run &) = delete;
+  Run &operator=(const Run &) = delete;
+
   template <typename T> void bind_arguments(T arg)
   {
-    err = this->cl_kernel.setArg(this->arg_count++, arg);
-    clerror::throw_opencl_error(err);
+    this->set_argument(this->arg_count++, arg);
   }
 
   template <typename T> void set_argument(int arg_pos, T arg)
   {
+    if (this->is_host)
+    {
+      this->host_args.set_value(arg_pos, &arg, sizeof(T));
+      return;
+    }
+
     err = this->cl_kernel.setArg(arg_pos, arg);
     clerror::throw_opencl_error(err);
   }
@@ -72,85 +136,423 @@ public:
     (this->bind_arguments(args), ...);
   }
 
+  // in zero-copy mode, the host data are shared with the device if they are
+  // suitably aligned (see HostVector), and otherwise copied (through a host
+  // accessible buffer with ZeroCopyMode::ALWAYS)
+  template <typename T, typename A>
+  BufferHandle bind_buffer(const std::string &id,
+                           std::vector<T, A> &vector,
+                           cl_mem_flags       flags = CL_MEM_READ_WRITE)
+  {
+    return this->bind_buffer_impl(id,
+                                  static_cast<void *>(vector.data()),
+                                  vector_sizeof<T, A>(vector),
+                                  flags);
+  }
+
+  template <typename T, typename A>
+  BufferHandle bind_buffer(const std::string       &id,
+                           const std::vector<T, A> &vector,
+                           cl_mem_flags             flags = CL_MEM_READ_WRITE)
+  {
+    return this->bind_buffer<T, A>(id,
+                                   const_cast<std::vector<T, A> &>(vector),
+                                   flags);
+  }
+
+  // bind a device-resident array, host data are uploaded before the launch
+  // only if they have been modified, and never downloaded by the Run. The
+  // array must belong to the runtime of the Run, and the Run must not use
+  // the host backend (std::invalid_argument otherwise)
   template <typename T>
-  void bind_buffer(const std::string &id,
-                   std::vector<T>    &vector,
-                   cl_mem_flags       flags = CL_MEM_READ_WRITE)
+  void bind_buffer(const std::string &id, DeviceArray<T> &array)
   {
-    Buffer buffer;
-
-    buffer.vector_ref = static_cast<void *>(vector.data());
-    buffer.size = vector_sizeof<T>(vector);
-    buffer.cl_buffer = cl::Buffer(KernelManager::context(),
-                                  flags,
-                                  buffer.size,
-                                  nullptr,
-                                  &err);
-    clerror::throw_opencl_error(err);
+    cl::Buffer buffer = array.get_buffer();
+
+    this->check_context(id, buffer.getInfo<CL_MEM_CONTEXT>());
 
-    err = this->cl_kernel.setArg(this->arg_count++, buffer.cl_buffer);
+    err = this->cl_kernel.setArg(this->arg_count++, buffer);
     clerror::throw_opencl_error(err);
 
-    this->buffers[id] = buffer;
+    this->resources[id] = &array;
   }
 
-  template <typename T>
-  void bind_buffer(const std::string    &id,
-                   const std::vector<T> &vector,
-                   cl_mem_flags          flags = CL_MEM_READ_WRITE)
+  // images of any format supported by the device. The channel order gives
+  // the number of values per pixel interleaved in the vector (CL_R, CL_RG,
+  // CL_RGBA...) and the channel type their storage, by default the one
+  // matching T (see ImageFormatTraits). Input data are copied at binding
+  template <typename T, typename A>
+  ImageHandle bind_image(const std::string &id,
+                         std::vector<T, A> &vector,
+                         int                width,
+                         int                height,
+                         Direction          direction,
+                         cl_channel_order   channel_order = CL_R,
+                         cl_channel_type    channel_type =
+                             ImageFormatTraits<T>::channel_type)
   {
-    this->bind_buffer<T>(id, const_cast<std::vector<float> &>(vector), flags);
+    return this->bind_image_impl(id,
+                                 static_cast<void *>(vector.data()),
+                                 vector_sizeof<T, A>(vector),
+                                 sizeof(T),
+                                 {width, height, 1},
+                                 CL_MEM_OBJECT_IMAGE2D,
+                                 cl::ImageFormat(channel_order, channel_type),
+                                 direction);
   }
 
-  // data are copied at binding
-  void bind_imagef(const std::string  &id,
-                   std::vector<float> &vector,
-                   int                 width,
-                   int                 height,
-                   Direction           direction);
-
-  void bind_imagef(const std::string  &id,
-                   std::vector<float> &vector,
-                   int                 width,
-                   int                 height,
-                   bool                is_out = false);
-
-  void bind_imagef(const std::string        &id,
-                   const std::vector<float> &vector,
-                   int                       width,
-                   int                       height,
-                   bool                      is_out = false);
+  // write-only 3D images require the cl_khr_3d_image_writes extension
+  template <typename T, typename A>
+  ImageHandle bind_image3d(const std::string &id,
+                           std::vector<T, A> &vector,
+                           int                width,
+                           int                height,
+                           int                depth,
+                           Direction          direction,
+                           cl_channel_order   channel_order = CL_R,
+                           cl_channel_type    channel_type =
+                               ImageFormatTraits<T>::channel_type)
+  {
+    return this->bind_image_impl(id,
+                                 static_cast<void *>(vector.data()),
+                                 vector_sizeof<T, A>(vector),
+                                 sizeof(T),
+                                 {width, height, depth},
+                                 CL_MEM_OBJECT_IMAGE3D,
+                                 cl::ImageFormat(channel_order, channel_type),
+                                 direction);
+  }
+
+  // layers are stored one after the other in the vector
+  template <typename T, typename A>
+  ImageHandle bind_image2d_array(const std::string &id,
+                                 std::vector<T, A> &vector,
+                                 int                width,
+                                 int                height,
+                                 int                layers,
+                                 Direction          direction,
+                                 cl_channel_order   channel_order = CL_R,
+                                 cl_channel_type    channel_type =
+                                     ImageFormatTraits<T>::channel_type)
+  {
+    return this->bind_image_impl(id,
+                                 static_cast<void *>(vector.data()),
+                                 vector_sizeof<T, A>(vector),
+                                 sizeof(T),
+                                 {width, height, layers},
+                                 CL_MEM_OBJECT_IMAGE2D_ARRAY,
+                                 cl::ImageFormat(channel_order, channel_type),
+                                 direction);
+  }
 
+  // same requirements as DeviceArray
+  void bind_imagef(const std::string &id, DeviceImage &image);
+
+  // data are copied at binding
+  ImageHandle bind_imagef(const std::string  &id,
+                          std::vector<float> &vector,
+                          int                 width,
+                          int                 height,
+                          Direction           direction);
+
+  ImageHandle bind_imagef(const std::string  &id,
+                          std::vector<float> &vector,
+                          int                 width,
+                          int                 height,
+                          bool                is_out = false);
+
+  ImageHandle bind_imagef(const std::string        &id,
+                          const std::vector<float> &vector,
+                          int                       width,
+                          int                       height,
+                          bool                      is_out = false);
+
+  // the elapsed time (ms) is the device execution time if profiling is
+  // enabled, the host wall time of the launch otherwise. The launch is
+  // recorded by the KernelProfiler before returning
   void execute(int total_elements, float *p_elapsed_time = nullptr);
 
+  // only blocking if the elapsed time is requested (the launch is otherwise
+  // recorded once complete, see KernelProfiler::flush)
   void execute(const std::vector<int> &global_range_2d,
                float                  *p_elapsed_time = nullptr);
 
+  // non-blocking variants, the commands start once the events of the wait
+  // list are complete. Host vectors must not be accessed before the returned
+  // event is complete
+  Event execute_async(int                       total_elements,
+                      const std::vector<Event> &wait_list = {});
+
+  Event execute_async(const std::vector<int>   &global_range_2d,
+                      const std::vector<Event> &wait_list = {});
+
+  // bytes not uploaded thanks to the dirty-range tracking
+  size_t get_bytes_saved() const
+  {
+    return this->bytes_saved;
+  }
+
+  // invalid handle if the id is unknown
+  BufferHandle get_buffer_handle(const std::string &id) const;
+
+  ImageHandle get_image_handle(const std::string &id) const;
+
+  // how the buffer is backed (BufferMode::COPY if the id is unknown)
+  BufferMode get_buffer_mode(const std::string &id) const;
+
+  // record a host range (in bytes) modified since the last upload. Instead
+  // of the whole buffer, the recorded ranges are uploaded before the next
+  // launch, nearby ones being merged into a single transfer
+  void mark_dirty(const std::string &id, size_t offset, size_t size);
+
+  void mark_dirty(BufferHandle handle, size_t offset, size_t size);
+
   void read_buffer(const std::string &id);
 
+  void read_buffer(BufferHandle handle);
+
+  Event read_buffer_async(const std::string        &id,
+                          const std::vector<Event> &wait_list = {});
+
+  Event read_buffer_async(BufferHandle              handle,
+                          const std::vector<Event> &wait_list = {});
+
+  // sub-range transfers, offset and size in bytes
+  void read_buffer(const std::string &id, size_t offset, size_t size);
+
+  void read_buffer(BufferHandle handle, size_t offset, size_t size);
+
+  Event read_buffer_async(const std::string        &id,
+                          size_t                    offset,
+                          size_t                    size,
+                          const std::vector<Event> &wait_list = {});
+
+  Event read_buffer_async(BufferHandle              handle,
+                          size_t                    offset,
+                          size_t                    size,
+                          const std::vector<Event> &wait_list = {});
+
   void read_imagef(const std::string &id);
 
+  Event read_imagef_async(const std::string        &id,
+                          const std::vector<Event> &wait_list = {});
+
+  // any image bound by bind_image, bind_image3d or bind_image2d_array
+  void read_image(const std::string &id);
+
+  void read_image(ImageHandle handle);
+
+  Event read_image_async(const std::string        &id,
+                         const std::vector<Event> &wait_list = {});
+
+  Event read_image_async(ImageHandle               handle,
+                         const std::vector<Event> &wait_list = {});
+
+  // bind other host data to an already bound buffer. The device buffer is
+  // kept if the size is unchanged (the data are not uploaded, see
+  // write_buffer), and replaced otherwise
+  template <typename T, typename A>
+  void rebind(BufferHandle handle, std::vector<T, A> &vector)
+  {
+    this->rebind_buffer_impl(handle,
+                             static_cast<void *>(vector.data()),
+                             vector_sizeof<T, A>(vector));
+  }
+
+  // same for images, the host data must have the image dimensions and
+  // format. Input data are copied as at binding
+  template <typename T, typename A>
+  void rebind(ImageHandle handle, std::vector<T, A> &vector)
+  {
+    this->rebind_image_impl(handle,
+                            static_cast<void *>(vector.data()),
+                            vector_sizeof<T, A>(vector),
+                            sizeof(T));
+  }
+
+  // true if the kernel runs on the host backend
+  bool is_host_backend() const
+  {
+    return this->is_host;
+  }
+
   void reset_argcount()
   {
     this->arg_count = 0;
   }
 
+  // queue used by the following commands (default to the queue shared by
+  // the KernelManager), created for the context of the runtime of the Run
+  void set_queue(const cl::CommandQueue &new_queue);
+
   void write_buffer(const std::string &id);
 
+  void write_buffer(BufferHandle handle);
+
+  Event write_buffer_async(const std::string        &id,
+                           const std::vector<Event> &wait_list = {});
+
+  Event write_buffer_async(BufferHandle              handle,
+                           const std::vector<Event> &wait_list = {});
+
+  void write_buffer(const std::string &id, size_t offset, size_t size);
+
+  void write_buffer(BufferHandle handle, size_t offset, size_t size);
+
+  Event write_buffer_async(const std::string        &id,
+                           size_t                    offset,
+                           size_t                    size,
+                           const std::vector<Event> &wait_list = {});
+
+  Event write_buffer_async(BufferHandle              handle,
+                           size_t                    offset,
+                           size_t                    size,
+                           const std::vector<Event> &wait_list = {});
+
   void write_imagef(const std::string &id);
 
+  Event write_imagef_async(const std::string        &id,
+                           const std::vector<Event> &wait_list = {});
+
+  void write_image(const std::string &id);
+
+  void write_image(ImageHandle handle);
+
+  Event write_image_async(const std::string        &id,
+                          const std::vector<Event> &wait_list = {});
+
+  Event write_image_async(ImageHandle               handle,
+                          const std::vector<Event> &wait_list = {});
+
 private:
+  BufferHandle bind_buffer_impl(const std::string &id,
+                                void              *vector_ref,
+                                size_t             size,
+                                cl_mem_flags       flags);
+
+  // 'dims' are the width, height and depth (or number of layers)
+  ImageHandle bind_image_impl(const std::string        &id,
+                              void                     *vector_ref,
+                              size_t                    size,
+                              size_t                    value_size,
+                              const std::array<int, 3> &dims,
+                              cl_mem_object_type        type,
+                              const cl::ImageFormat    &format,
+                              Direction                 direction);
+
+  // the device buffer for the given host data
+  void create_buffer(Buffer &buffer);
+
+  // the device image, checking that the format is supported
+  void create_image(Image &img);
+
+  // throws std::invalid_argument if an OpenCL object given for 'id' does
+  // not belong to the context of the runtime, or on the host backend
+  void check_context(const std::string &id, const cl::Context &context) const;
+
+  // the global size is rounded up to a multiple of the local size (or of
+  // a small power of 2 when the local size is left to the driver), kernels
+  // must check their global id against the actual problem size. Timings of
+  // blocking launches are recorded by the caller once complete
+  Event enqueue_kernel(const std::vector<size_t> &global_size,
+                       const std::vector<Event>  &wait_list,
+                       bool                       is_blocking = false);
+
+  // invalid handle (and an error logged) if the id is unknown
+  BufferHandle find_buffer(const std::string &id) const;
+
+  ImageHandle find_image(const std::string &id) const;
+
+  // nullptr if the handle is not valid (logged unless it is the invalid
+  // handle returned for unknown ids, already logged)
+  Buffer *get_buffer(BufferHandle handle);
+
+  Image *get_image(ImageHandle handle);
+
+  float get_elapsed_time(
+      const Event                                          &event,
+      const std::chrono::high_resolution_clock::time_point &t0) const;
+
+  void rebind_buffer_impl(BufferHandle handle, void *vector_ref, size_t size);
+
+  void rebind_image_impl(ImageHandle handle,
+                         void       *vector_ref,
+                         size_t      size,
+                         size_t      value_size);
+
+  // wait for the pending commands and give the kernel, buffers and images
+  // back to the pools
+  void release();
+
+  // unmap the buffer and give it back to the pool once the commands using
+  // it are complete
+  void release_buffer(Buffer &buffer);
+
+  void setup_runtime(KernelManager &runtime);
+
+  // 2D images go back to the pool
+  void release_image(Image &img);
+
+  // wait for the commands enqueued by this Run, if any
+  void wait_pending();
+
+  // device buffer or SVM pointer
+  void set_buffer_arg(Buffer &buffer);
+
+  // give zero-copy buffers mapped by read_buffer back to the device,
+  // returns the events to wait for
+  std::vector<cl::Event> unmap_buffers();
+
+  // upload the ranges recorded by mark_dirty, returns the events to wait for
+  std::vector<cl::Event> upload_dirty_ranges();
+
   std::string kernel_name;
 
+  KernelManager *p_runtime = nullptr;
+
   cl::CommandQueue queue;
 
   cl::Kernel cl_kernel;
 
   int arg_count = 0;
 
-  std::map<std::string, Buffer> buffers;
+  // indexed by the handles
+  std::vector<Buffer> buffers;
+
+  std::vector<Image> images;
+
+  std::map<std::string, size_t> buffer_indices;
+
+  std::map<std::string, size_t> image_indices;
+
+  // device-resident arrays and images, not owned by the Run
+  std::map<std::string, DeviceResource *> resources;
+
+  // set when commands may still be running on the queue
+  bool is_pending = false;
+
+  // set if the queue has been created with profiling enabled
+  bool is_profiling = false;
+
+  bool is_zero_copy = false;
+
+  // unaligned host data use host accessible buffers (ZeroCopyMode::ALWAYS)
+  bool is_pinned = false;
+
+  // host backend, no OpenCL object is used
+  bool is_host = false;
+
+  HostArgs host_args;
+
+  // local size given by the Autotuner for the last global size, valid for
+  // a given tuner generation
+  std::vector<size_t> tuned_global_size;
+
+  std::vector<size_t> tuned_local_size;
+
+  size_t tuned_generation = 0;
 
-  std::map<std::string, Image2D> images_2d;
+  size_t bytes_saved = 0;
 
   int err = 0;
 };
@@ -0,0 +1,140 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file stream_run.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Out-of-core execution of elementwise or row-local kernels, with
+ * chunk uploads, computations and downloads overlapping each other.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <map>
+
+#include <CL/opencl.hpp>
+
+#include "cl_error_lookup.hpp"
+
+#include "cl_wrapper/run.hpp"
+
+namespace clwrapper
+{
+
+// times in ms, measured on the device
+struct StreamStats
+{
+  size_t chunks = 0;
+  float  upload_time = 0.f;
+  float  compute_time = 0.f;
+  float  download_time = 0.f;
+  float  wall_time = 0.f; // host time of the whole execution
+  float  overlap = 0.f;   // fraction of the transfer time hidden by compute
+};
+
+// The data are processed by chunks of 'chunk_size' elements (1D) or rows
+// (2D), each chunk using one of 'buffer_count' rotating sets of device
+// buffers: chunk k+1 is uploaded while chunk k is computed and chunk k-1
+// downloaded, on separate queues. The kernel sees the chunk buffers and
+// receives, after its bound arguments, the number of elements (1D) or rows
+// (2D) of the chunk (the global size is rounded up). Kernels and buffers
+// are taken from the given runtime, which must outlive the StreamRun.
+class StreamRun
+{
+public:
+  StreamRun(const std::string &kernel_name,
+            size_t             chunk_size,
+            size_t             buffer_count = 2,
+            KernelManager     &runtime = KernelManager::get_instance());
+
+  ~StreamRun();
+
+  StreamRun(const StreamRun &) = delete;
+  StreamRun &operator=(const StreamRun &) = delete;
+
+  template <typename T> void bind_arguments(T arg)
+  {
+    for (auto &kernel : this->kernels)
+    {
+      err = kernel.setArg(this->arg_count, arg);
+      clerror::throw_opencl_error(err);
+    }
+    this->arg_count++;
+  }
+
+  template <typename... Args> void bind_arguments(Args... args)
+  {
+    (this->bind_arguments(args), ...);
+  }
+
+  // streamed data, split along its last dimension like the global range
+  // (the size must be a multiple of the global range, see execute)
+  template <typename T, typename A>
+  void bind_buffer(const std::string &id,
+                   std::vector<T, A> &vector,
+                   Direction          direction)
+  {
+    StreamedBuffer buffer;
+    buffer.vector_ref = static_cast<void *>(vector.data());
+    buffer.size = vector_sizeof<T, A>(vector);
+    buffer.direction = direction;
+    buffer.arg_index = this->arg_count++;
+
+    this->buffers[id] = buffer;
+  }
+
+  // the last chunk may be shorter than the others. Throws
+  // std::invalid_argument if a buffer size is not a multiple of the number
+  // of elements (1D) or rows (2D)
+  void execute(int total_elements);
+
+  void execute(const std::vector<int> &global_range_2d);
+
+  // statistics of the last execution
+  StreamStats get_stats() const
+  {
+    return this->stats;
+  }
+
+private:
+  struct StreamedBuffer
+  {
+    std::vector<cl::Buffer> cl_buffers; // one per rotating slot
+    void                   *vector_ref;
+    size_t                  size;
+    Direction               direction;
+    int                     arg_index;
+  };
+
+  // device buffers sized after the chunk, bound to the slot kernels
+  void allocate(size_t unit_count);
+
+  void execute_chunks(size_t unit_count, size_t unit_width, bool is_2d);
+
+  void release_buffers();
+
+  std::string kernel_name;
+
+  KernelManager *p_runtime; // not owned
+
+  size_t chunk_size;
+
+  std::vector<cl::Kernel> kernels; // one per rotating slot
+
+  std::map<std::string, StreamedBuffer> buffers;
+
+  cl::CommandQueue upload_queue;
+
+  cl::CommandQueue compute_queue;
+
+  cl::CommandQueue download_queue;
+
+  StreamStats stats;
+
+  int arg_count = 0;
+
+  int err = 0;
+};
+
+} // namespace clwrapper
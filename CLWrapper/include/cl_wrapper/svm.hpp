@@ -0,0 +1,108 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file svm.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief OpenCL 2.0 shared virtual memory (SVM) allocations, enabled with
+ * the CLWRAPPER_ENABLE_SVM build option.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <vector>
+
+#include <CL/opencl.hpp>
+
+#include "cl_wrapper/host_memory.hpp"
+
+namespace clwrapper
+{
+
+struct SVMAllocation
+{
+  cl::Context      context;
+  cl::CommandQueue queue; // of the allocating runtime, used to free
+  size_t           size;
+  bool             is_fine_grain; // shared without any map / unmap
+  bool             is_mapped;     // coarse-grained, owned by the host
+  cl::Event        last_use;      // last command enqueued on the allocation
+};
+
+// CL_DEVICE_SVM_CAPABILITIES, 0 if the library is built without SVM support
+// or if the device is not an OpenCL 2.0 device
+cl_bitfield get_svm_capabilities(const cl::Device &cl_device);
+
+// SVM allocation in the context of the default runtime (created if needed),
+// fine-grained if the device supports it and coarse-grained otherwise.
+// Coarse-grained allocations are returned mapped (owned by the host). Falls
+// back, with a warning, to a page aligned host allocation usable for
+// zero-copy buffers if SVM is not available (see is_svm_pointer)
+void *svm_alloc(size_t size);
+
+// SVM or fallback allocation. SVM allocations are freed once the last
+// command using them is complete (see svm_set_last_use). Called from
+// allocators and destructors, OpenCL errors are only logged
+void svm_free(void *ptr) noexcept;
+
+// false if 'ptr' is not the start of an SVM allocation
+bool find_svm_allocation(const void *ptr, SVMAllocation &allocation);
+
+// true if 'ptr' is the start of an SVM allocation, false for a fallback
+// allocation
+bool is_svm_pointer(const void *ptr);
+
+// coarse-grained allocations are given to the host (map) or to the device
+// (unmap). Nothing is enqueued if the allocation is already in the requested
+// state, the event is then empty
+cl::Event svm_map(const cl::CommandQueue       &queue,
+                  void                         *ptr,
+                  cl_map_flags                  flags,
+                  const std::vector<cl::Event> *p_wait_list);
+
+cl::Event svm_unmap(const cl::CommandQueue       &queue,
+                    void                         *ptr,
+                    const std::vector<cl::Event> *p_wait_list);
+
+void svm_set_kernel_arg(const cl::Kernel &kernel, cl_uint index, void *ptr);
+
+// record the last command (kernel launch) using an SVM allocation, maps and
+// unmaps are recorded by svm_map / svm_unmap
+void svm_set_last_use(const void *ptr, const cl::Event &event);
+
+template <typename T> struct SVMAllocator
+{
+  using value_type = T;
+
+  SVMAllocator() = default;
+
+  template <typename U> SVMAllocator(const SVMAllocator<U> &)
+  {
+  }
+
+  T *allocate(size_t n)
+  {
+    return static_cast<T *>(svm_alloc(n * sizeof(T)));
+  }
+
+  void deallocate(T *p, size_t)
+  {
+    svm_free(p);
+  }
+
+  template <typename U> bool operator==(const SVMAllocator<U> &) const
+  {
+    return true;
+  }
+
+  template <typename U> bool operator!=(const SVMAllocator<U> &) const
+  {
+    return false;
+  }
+};
+
+// host vector shared with the device through SVM when available
+template <typename T> using SVMVector = std::vector<T, SVMAllocator<T>>;
+
+} // namespace clwrapper
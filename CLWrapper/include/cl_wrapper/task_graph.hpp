@@ -0,0 +1,95 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file task_graph.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Graph of kernel launches, dependencies inferred from the resources
+ * each launch reads and writes.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <vector>
+
+#include <CL/opencl.hpp>
+
+#include "cl_wrapper/device_array.hpp"
+#include "cl_wrapper/event.hpp"
+#include "cl_wrapper/run.hpp"
+
+namespace clwrapper
+{
+
+struct TaskNode
+{
+  Run *p_run; // not owned
+
+  std::vector<int> global_range; // 1D or 2D
+
+  std::vector<const DeviceResource *> reads;
+
+  std::vector<const DeviceResource *> writes;
+
+  std::vector<size_t> dependencies; // indices of the nodes to wait for
+
+  bool is_sink = true; // no other node depends on this one
+};
+
+// Tasks are submitted on an out-of-order queue (or, if the device does not
+// support it, on several in-order queues) and linked by events, so that
+// independent branches can run concurrently. Dependencies follow the order
+// in which tasks are added: a task waits for the last writer of each
+// resource it reads or writes, and for the readers of each resource it
+// writes (write after read).
+class TaskGraph
+{
+public:
+  // 'fallback_queue_count' in-order queues are used if out-of-order
+  // execution is not supported. The queues are created for the device of
+  // the given runtime, the tasks must be Run instances of the same runtime
+  TaskGraph(size_t         fallback_queue_count = 2,
+            KernelManager &runtime = KernelManager::get_instance());
+
+  TaskGraph(const TaskGraph &) = delete;
+  TaskGraph &operator=(const TaskGraph &) = delete;
+
+  // the Run (arguments already bound) must outlive the graph execution, the
+  // resources also need to be bound to the Run. Returns the task index
+  size_t add_task(Run                                       &run,
+                  const std::vector<int>                    &global_range,
+                  const std::vector<const DeviceResource *> &reads,
+                  const std::vector<const DeviceResource *> &writes);
+
+  // explicit dependency, for data not tracked by the graph ('depends_on'
+  // must have been added before 'task')
+  void add_dependency(size_t task, size_t depends_on);
+
+  void clear();
+
+  // submit every task and wait for the sinks of the graph only
+  void execute();
+
+  // submit every task, returns the events of the sinks of the graph
+  std::vector<Event> execute_async();
+
+  const std::vector<TaskNode> &get_tasks() const
+  {
+    return this->tasks;
+  }
+
+  bool is_out_of_order() const
+  {
+    return this->out_of_order;
+  }
+
+private:
+  std::vector<TaskNode> tasks;
+
+  std::vector<cl::CommandQueue> queues;
+
+  bool out_of_order = false;
+};
+
+} // namespace clwrapper
@@ -0,0 +1,121 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file tiled_run.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Execution of 2D image stencil kernels on rasters too large for a
+ * single device image, by overlapping tiles.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <map>
+
+#include <CL/opencl.hpp>
+
+#include "cl_error_lookup.hpp"
+
+#include "cl_wrapper/run.hpp"
+
+namespace clwrapper
+{
+
+// The raster is cut into tiles extended by 'halo' pixels on each side
+// (clipped at the raster borders), the kernel runs on each tile and only the
+// tile interiors are stitched back into the output arrays. Tiles rotate over
+// 'buffer_count' sets of images, uploads, kernels and downloads running on
+// separate queues.
+//
+// Kernels follow the usual image kernel convention: the images (in binding
+// order), then the width and height of the tile, then the arguments given
+// to bind_arguments. The sampler should clamp to edge so that tiles on the
+// raster borders give the same result as the full raster.
+class TiledRun
+{
+public:
+  // a 'tile_size' of 0 uses the largest tile allowed by the device (within
+  // a default limit). Kernel and images are taken from the given runtime,
+  // which must outlive the TiledRun
+  TiledRun(const std::string &kernel_name,
+           int                halo,
+           int                tile_size = 0,
+           size_t             buffer_count = 2,
+           KernelManager     &runtime = KernelManager::get_instance());
+
+  ~TiledRun();
+
+  TiledRun(const TiledRun &) = delete;
+  TiledRun &operator=(const TiledRun &) = delete;
+
+  // extra arguments, after the tile width and height
+  template <typename T> void bind_arguments(T arg)
+  {
+    int index = (int)this->images.size() + 2 + this->extra_arg_count++;
+    err = this->cl_kernel.setArg(index, arg);
+    clerror::throw_opencl_error(err);
+  }
+
+  template <typename... Args> void bind_arguments(Args... args)
+  {
+    (this->bind_arguments(args), ...);
+  }
+
+  // the images need to be bound before the extra arguments
+  void bind_imagef(const std::string  &id,
+                   std::vector<float> &vector,
+                   Direction           direction);
+
+  void execute(int width, int height);
+
+  int get_tile_size() const
+  {
+    return this->tile_size;
+  }
+
+private:
+  struct TiledImage
+  {
+    std::vector<float> *p_vector;
+    Direction           direction;
+    int                 arg_index;
+
+    // per rotating slot, by tile dimensions (tiles on the raster borders
+    // are smaller)
+    std::vector<std::map<std::pair<int, int>, cl::Image2D>> cl_images;
+  };
+
+  cl::Image2D get_tile_image(TiledImage &image,
+                             size_t      slot,
+                             int         width,
+                             int         height);
+
+  void release_images();
+
+  std::string kernel_name;
+
+  KernelManager *p_runtime; // not owned
+
+  cl::Kernel cl_kernel; // arguments are captured at each enqueue
+
+  int halo;
+
+  int tile_size;
+
+  size_t buffer_count;
+
+  std::map<std::string, TiledImage> images;
+
+  cl::CommandQueue upload_queue;
+
+  cl::CommandQueue compute_queue;
+
+  cl::CommandQueue download_queue;
+
+  int extra_arg_count = 0;
+
+  int err = 0;
+};
+
+} // namespace clwrapper
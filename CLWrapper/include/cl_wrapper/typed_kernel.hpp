@@ -0,0 +1,240 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file typed_kernel.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Kernel handle with a compile-time argument signature.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <optional>
+#include <tuple>
+#include <utility>
+
+#include <CL/opencl.hpp>
+
+#include "cl_error_lookup.hpp"
+
+#include "cl_wrapper/autotuner.hpp"
+#include "cl_wrapper/event.hpp"
+#include "cl_wrapper/kernel_manager.hpp"
+
+namespace clwrapper
+{
+
+// kernel argument types which are not host scalar types
+namespace arg
+{
+
+template <typename T> struct Buffer // global T *
+{
+};
+
+struct Image2D // image2d_t
+{
+};
+
+} // namespace arg
+
+// host value given for each kernel argument type and its OpenCL C type
+// name, as reported by CL_KERNEL_ARG_TYPE_NAME
+template <typename T> struct ArgTraits;
+
+#define CLWRAPPER_ARG_TYPE_NAME(T, NAME)                                       \
+  template <> struct ArgTraits<T>                                              \
+  {                                                                            \
+    using host_type = T;                                                       \
+    static std::string type_name()                                             \
+    {                                                                          \
+      return NAME;                                                             \
+    }                                                                          \
+  };
+
+CLWRAPPER_ARG_TYPE_NAME(cl_char, "char")
+CLWRAPPER_ARG_TYPE_NAME(cl_uchar, "uchar")
+CLWRAPPER_ARG_TYPE_NAME(cl_short, "short")
+CLWRAPPER_ARG_TYPE_NAME(cl_ushort, "ushort")
+CLWRAPPER_ARG_TYPE_NAME(cl_int, "int")
+CLWRAPPER_ARG_TYPE_NAME(cl_uint, "uint")
+CLWRAPPER_ARG_TYPE_NAME(cl_long, "long")
+CLWRAPPER_ARG_TYPE_NAME(cl_ulong, "ulong")
+CLWRAPPER_ARG_TYPE_NAME(cl_float, "float")
+CLWRAPPER_ARG_TYPE_NAME(cl_double, "double")
+
+#undef CLWRAPPER_ARG_TYPE_NAME
+
+template <typename T> struct ArgTraits<arg::Buffer<T>>
+{
+  using host_type = cl::Buffer;
+
+  static std::string type_name()
+  {
+    return ArgTraits<T>::type_name() + "*";
+  }
+};
+
+template <> struct ArgTraits<arg::Image2D>
+{
+  using host_type = cl::Image2D;
+
+  static std::string type_name()
+  {
+    return "image2d_t";
+  }
+};
+
+// values compared to decide whether an argument has changed
+template <typename T> bool is_same_arg(const T &a, const T &b)
+{
+  return a == b;
+}
+
+inline bool is_same_arg(const cl::Buffer &a, const cl::Buffer &b)
+{
+  return a() == b();
+}
+
+inline bool is_same_arg(const cl::Image2D &a, const cl::Image2D &b)
+{
+  return a() == b();
+}
+
+// checks the number of arguments and, if the program has been built with
+// '-cl-kernel-arg-info', their types. Throws CL_INVALID_KERNEL_ARGS on
+// mismatch
+void validate_kernel_signature(const cl::Kernel               &kernel,
+                               const std::string              &kernel_name,
+                               const std::vector<std::string> &type_names);
+
+// Kernel handle whose arguments are typed at compile time, e.g.
+//
+//   Kernel<arg::Buffer<float>, arg::Buffer<float>, int, float>
+//
+// for 'kernel void f(global float *, global float *, int, float)'. The
+// signature is validated once against the kernel, arguments are converted
+// to the declared types and only the arguments which changed since the last
+// launch are set. Buffers and images are given as OpenCL objects, e.g.
+// DeviceArray::get_buffer() (synchronization is up to the caller)
+template <typename... Args> class Kernel
+{
+public:
+  Kernel(const std::string &kernel_name,
+         KernelManager     &runtime = KernelManager::get_instance())
+      : kernel_name(kernel_name), p_runtime(&runtime)
+  {
+    this->cl_kernel = runtime.checkout_kernel(kernel_name);
+    this->queue = runtime.get_queue();
+
+    validate_kernel_signature(this->cl_kernel,
+                              kernel_name,
+                              {ArgTraits<Args>::type_name()...});
+  }
+
+  ~Kernel()
+  {
+    this->p_runtime->release_kernel(this->kernel_name, this->cl_kernel);
+  }
+
+  Kernel(const Kernel &) = delete;
+  Kernel &operator=(const Kernel &) = delete;
+
+  // blocking
+  void execute(const std::vector<size_t> &global_size)
+  {
+    this->execute_async(global_size).wait();
+  }
+
+  Event execute_async(const std::vector<size_t> &global_size,
+                      const std::vector<Event>  &wait_list = {})
+  {
+    std::vector<cl::Event> cl_wait_list = to_cl_events(wait_list);
+    cl::Event              cl_event;
+
+    std::vector<size_t> local_size = Autotuner::get_instance().get_local_size(
+        this->kernel_name,
+        this->cl_kernel,
+        this->queue,
+        global_size,
+        cl_wait_list);
+
+    int err = this->queue.enqueueNDRangeKernel(
+        this->cl_kernel,
+        cl::NullRange,
+        to_ndrange(Autotuner::pad_global_size(global_size, local_size)),
+        to_ndrange(local_size),
+        cl_wait_list.empty() ? nullptr : &cl_wait_list,
+        &cl_event);
+    clerror::throw_opencl_error(err);
+
+    this->queue.flush();
+
+    return Event(cl_event);
+  }
+
+  cl::Kernel get_kernel() const
+  {
+    return this->cl_kernel;
+  }
+
+  // number of clSetKernelArg calls skipped since the creation
+  size_t get_skipped_count() const
+  {
+    return this->skipped_count;
+  }
+
+  template <size_t I>
+  void set_arg(
+      const typename ArgTraits<
+          std::tuple_element_t<I, std::tuple<Args...>>>::host_type &value)
+  {
+    auto &last = std::get<I>(this->last_values);
+
+    if (last && is_same_arg(*last, value))
+    {
+      this->skipped_count++;
+      return;
+    }
+
+    int err = this->cl_kernel.setArg((cl_uint)I, value);
+    clerror::throw_opencl_error(err);
+
+    last = value;
+  }
+
+  void set_args(const typename ArgTraits<Args>::host_type &...values)
+  {
+    this->set_args_impl(std::index_sequence_for<Args...>{}, values...);
+  }
+
+  void set_queue(const cl::CommandQueue &new_queue)
+  {
+    this->queue = new_queue;
+  }
+
+private:
+  template <size_t... I>
+  void set_args_impl(std::index_sequence<I...>,
+                     const typename ArgTraits<Args>::host_type &...values)
+  {
+    (this->template set_arg<I>(values), ...);
+  }
+
+  std::string kernel_name;
+
+  KernelManager *p_runtime;
+
+  cl::Kernel cl_kernel;
+
+  cl::CommandQueue queue;
+
+  // last value set for each argument
+  std::tuple<std::optional<typename ArgTraits<Args>::host_type>...>
+      last_values;
+
+  size_t skipped_count = 0;
+};
+
+} // namespace clwrapper
@@ -0,0 +1,421 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "cl_wrapper/autotuner.hpp"
+#include "cl_wrapper/binary_cache.hpp"
+#include "cl_wrapper/device_rating.hpp"
+#include "cl_wrapper/event.hpp"
+#include "cl_wrapper/logger.hpp"
+
+namespace clwrapper
+{
+
+// rounding of the global size when the local size is left to the driver
+static const size_t DEFAULT_GLOBAL_MULTIPLE = 8;
+
+// number of group sizes (doubling from the preferred multiple) tried
+static const int MAX_GROUP_SIZES = 6;
+
+static size_t helper_ceil_log2(size_t n)
+{
+  size_t k = 0;
+  while (((size_t)1 << k) < n)
+    k++;
+  return k;
+}
+
+Autotuner::Autotuner()
+{
+  if (const char *env_file = std::getenv("CLWRAPPER_TUNING_FILE"))
+    this->file_path = env_file;
+  else
+    this->file_path = (std::filesystem::path(
+                           BinaryCache::get_instance().get_directory()) /
+                       "tuning.txt")
+                          .string();
+
+  if (const char *env_tune = std::getenv("CLWRAPPER_AUTOTUNE"))
+    this->enabled = std::string(env_tune) != "0";
+}
+
+void Autotuner::clear()
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->entries.clear();
+  this->is_loaded = true;
+  this->generation++;
+
+  std::error_code ec;
+  std::filesystem::remove(this->file_path, ec);
+}
+
+std::vector<std::vector<size_t>> Autotuner::get_candidates(
+    const cl::Kernel          &cl_kernel,
+    const cl::Device          &cl_device,
+    const std::vector<size_t> &global_size) const
+{
+  size_t multiple = cl_kernel.getWorkGroupInfo<
+      CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE>(cl_device);
+  size_t max_size = cl_kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(
+      cl_device);
+  std::vector<size_t> max_item_sizes =
+      cl_device.getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES>();
+
+  multiple = std::max((size_t)1, multiple);
+
+  // left to the driver, used as the reference
+  std::vector<std::vector<size_t>> candidates = {{}};
+
+  size_t group_size = multiple;
+
+  for (int k = 0; k < MAX_GROUP_SIZES && group_size <= max_size; k++)
+  {
+    if (global_size.size() == 1)
+    {
+      // no group larger than the (padded) problem itself
+      if (group_size <= max_item_sizes[0] &&
+          group_size < 2 * global_size[0] + multiple)
+        candidates.push_back({group_size});
+    }
+    else
+    {
+      // wider than tall, rows are contiguous in memory
+      for (size_t ly = 1; ly * ly <= group_size; ly *= 2)
+      {
+        size_t lx = group_size / ly;
+
+        if (lx * ly != group_size || lx > max_item_sizes[0] ||
+            ly > max_item_sizes[1] || lx >= 2 * global_size[0] ||
+            ly >= 2 * global_size[1])
+          continue;
+
+        std::vector<size_t> local_size = {lx, ly};
+        local_size.resize(global_size.size(), 1);
+        candidates.push_back(local_size);
+      }
+    }
+
+    group_size *= 2;
+  }
+
+  return candidates;
+}
+
+std::string Autotuner::get_device_signature(const cl::Device &cl_device)
+{
+  auto it = this->device_signatures.find(cl_device());
+  if (it != this->device_signatures.end()) return it->second;
+
+  const std::string signature = clwrapper::get_device_signature(cl_device);
+
+  this->device_signatures[cl_device()] = signature;
+  return signature;
+}
+
+size_t Autotuner::get_entry_count() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->entries.size();
+}
+
+std::string Autotuner::get_file_path() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->file_path;
+}
+
+bool Autotuner::is_tunable(const std::string &kernel_name) const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->tunable_kernels.count(kernel_name) > 0;
+}
+
+std::string Autotuner::get_key(const std::string         &kernel_name,
+                               const cl::Device          &cl_device,
+                               const std::vector<size_t> &global_size)
+{
+  // kernel@device/bucket, e.g. 'add_kernel@3fa2c1.../10x10'
+  std::string key = kernel_name + "@" + this->get_device_signature(cl_device) +
+                    "/";
+
+  for (size_t k = 0; k < global_size.size(); k++)
+    key += (k > 0 ? "x" : "") +
+           std::to_string(helper_ceil_log2(global_size[k]));
+
+  return key;
+}
+
+std::vector<size_t> Autotuner::get_local_size(
+    const std::string            &kernel_name,
+    const cl::Kernel             &cl_kernel,
+    const cl::CommandQueue       &queue,
+    const std::vector<size_t>    &global_size,
+    const std::vector<cl::Event> &wait_list)
+{
+  // left to the driver, without touching the database
+  if (!this->enabled) return {};
+
+  cl::Device  cl_device = queue.getInfo<CL_QUEUE_DEVICE>();
+  std::string key;
+  int         repeats = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (!this->is_loaded) this->load();
+
+    key = this->get_key(kernel_name, cl_device, global_size);
+
+    auto it = this->entries.find(key);
+    if (it != this->entries.end()) return it->second;
+
+    // the kernel may not be idempotent, or is already being tuned
+    if (!this->tunable_kernels.count(kernel_name) ||
+        this->keys_in_tuning.count(key))
+      return {};
+
+    this->keys_in_tuning.insert(key);
+    repeats = this->repeats;
+  }
+
+  // the inputs of the kernel must be ready before it is timed
+  if (!wait_list.empty()) cl::Event::waitForEvents(wait_list);
+
+  std::vector<size_t> local_size = this->tune(kernel_name,
+                                              cl_kernel,
+                                              queue,
+                                              cl_device,
+                                              global_size,
+                                              repeats);
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->keys_in_tuning.erase(key);
+  this->entries[key] = local_size;
+  this->save();
+  this->generation++;
+
+  return local_size;
+}
+
+void Autotuner::load()
+{
+  this->entries.clear();
+  this->is_loaded = true;
+  this->generation++;
+
+  std::ifstream f(this->file_path);
+  if (!f.is_open()) return;
+
+  std::string line;
+
+  while (std::getline(f, line))
+  {
+    if (line.empty() || line[0] == '#') continue;
+
+    std::istringstream  iss(line);
+    std::string         key;
+    std::vector<size_t> local_size;
+    size_t              value;
+
+    iss >> key;
+    while (iss >> value)
+      local_size.push_back(value);
+
+    if (!key.empty()) this->entries[key] = local_size;
+  }
+
+  Logger::log()->trace("autotuner: {} entries loaded from {}",
+                       this->entries.size(),
+                       this->file_path);
+}
+
+std::vector<size_t> Autotuner::pad_global_size(
+    const std::vector<size_t> &global_size,
+    const std::vector<size_t> &local_size)
+{
+  std::vector<size_t> padded_size = global_size;
+
+  for (size_t k = 0; k < padded_size.size(); k++)
+  {
+    size_t b = k < local_size.size() ? local_size[k] : DEFAULT_GLOBAL_MULTIPLE;
+    padded_size[k] = ((padded_size[k] + b - 1) / b) * b;
+  }
+
+  return padded_size;
+}
+
+void Autotuner::save() const
+{
+  std::error_code       ec;
+  std::filesystem::path path(this->file_path);
+
+  if (path.has_parent_path())
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+  // written aside and renamed, the file is never seen partially written
+  const std::string tmp_path = this->file_path + ".tmp";
+
+  {
+    std::ofstream f(tmp_path, std::ios::trunc);
+
+    f << "# clwrapper tuning database: key local_size...\n";
+
+    for (auto &[key, local_size] : this->entries)
+    {
+      f << key;
+      for (auto v : local_size)
+        f << " " << v;
+      f << "\n";
+    }
+
+    if (!f.good())
+    {
+      Logger::log()->warn("autotuner: could not write {}", tmp_path);
+      f.close();
+      std::filesystem::remove(tmp_path, ec);
+      return;
+    }
+  }
+
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) std::filesystem::remove(tmp_path, ec);
+}
+
+void Autotuner::set_enabled(bool new_state)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->enabled = new_state;
+  this->generation++;
+}
+
+void Autotuner::set_file_path(const std::string &new_file_path)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->file_path = new_file_path;
+  this->load();
+}
+
+void Autotuner::set_repeats(int new_repeats)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->repeats = std::max(1, new_repeats);
+}
+
+void Autotuner::set_tunable(const std::string &kernel_name, bool new_state)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  if (new_state)
+    this->tunable_kernels.insert(kernel_name);
+  else
+    this->tunable_kernels.erase(kernel_name);
+
+  this->generation++;
+}
+
+float Autotuner::time_candidate(const cl::Kernel          &cl_kernel,
+                                const cl::CommandQueue    &queue,
+                                const std::vector<size_t> &global_size,
+                                const std::vector<size_t> &local_size,
+                                int                        repeats) const
+{
+  cl::NDRange global = to_ndrange(
+      Autotuner::pad_global_size(global_size, local_size));
+  cl::NDRange local = to_ndrange(local_size);
+
+  float best_time = -1.f;
+
+  // first launch is a warm-up
+  for (int k = 0; k < repeats + 1; k++)
+  {
+    cl::Event cl_event;
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    int err = queue.enqueueNDRangeKernel(cl_kernel,
+                                         cl::NullRange,
+                                         global,
+                                         local,
+                                         nullptr,
+                                         &cl_event);
+    if (err == CL_SUCCESS) err = cl_event.wait();
+
+    // e.g. not enough local memory for this group size
+    if (err != CL_SUCCESS) return -1.f;
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+
+    // device time if the queue has profiling enabled
+    EventTiming timing = Event(cl_event).get_timing();
+
+    float dt = timing.end > 0 ? timing.get_execution_time()
+                              : std::chrono::duration_cast<
+                                    std::chrono::nanoseconds>(t1 - t0)
+                                        .count() *
+                                    1e-6f;
+
+    if (k > 0 && (best_time < 0.f || dt < best_time)) best_time = dt;
+  }
+
+  return best_time;
+}
+
+std::vector<size_t> Autotuner::tune(const std::string         &kernel_name,
+                                    const cl::Kernel          &cl_kernel,
+                                    const cl::CommandQueue    &queue,
+                                    const cl::Device          &cl_device,
+                                    const std::vector<size_t> &global_size,
+                                    int                        repeats) const
+{
+  std::vector<size_t> best_local_size = {};
+  float               best_time = -1.f;
+
+  for (auto &local_size :
+       this->get_candidates(cl_kernel, cl_device, global_size))
+  {
+    float dt = this->time_candidate(cl_kernel,
+                                    queue,
+                                    global_size,
+                                    local_size,
+                                    repeats);
+
+    if (dt >= 0.f && (best_time < 0.f || dt < best_time))
+    {
+      best_time = dt;
+      best_local_size = local_size;
+    }
+  }
+
+  std::string str = best_local_size.empty() ? "driver" : "";
+  for (size_t k = 0; k < best_local_size.size(); k++)
+    str += (k > 0 ? "x" : "") + std::to_string(best_local_size[k]);
+
+  Logger::log()->info("autotuner: {} tuned, local size: {} ({:.3f} ms)",
+                      kernel_name,
+                      str,
+                      best_time);
+
+  return best_local_size;
+}
+
+cl::NDRange to_ndrange(const std::vector<size_t> &range)
+{
+  switch (range.size())
+  {
+  case 1: return cl::NDRange(range[0]);
+  case 2: return cl::NDRange(range[0], range[1]);
+  case 3: return cl::NDRange(range[0], range[1], range[2]);
+  default: return cl::NullRange;
+  }
+}
+
+} // namespace clwrapper
@@ -0,0 +1,381 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "cl_wrapper/binary_cache.hpp"
+#include "cl_wrapper/logger.hpp"
+
+namespace clwrapper
+{
+
+// cache entry layout: magic | payload size | payload checksum | payload
+static const char     CACHE_MAGIC[8] = {'C', 'L', 'W', 'B', 'I', 'N', '0', '1'};
+static const char    *CACHE_EXTENSION = ".clbin";
+static const uint64_t CHECKSUM_SEED = 0x636c77726170ULL;
+
+uint64_t hash_fnv1a(const void *data, size_t size, uint64_t seed)
+{
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  uint64_t             hash = 0xcbf29ce484222325ULL ^ seed;
+
+  for (size_t k = 0; k < size; k++)
+  {
+    hash ^= (uint64_t)p[k];
+    hash *= 0x100000001b3ULL;
+  }
+
+  return hash;
+}
+
+BinaryCache::BinaryCache()
+{
+  if (const char *env_dir = std::getenv("CLWRAPPER_CACHE_DIR"))
+  {
+    this->directory = env_dir;
+    this->enabled = this->directory.length() > 0;
+  }
+  else
+  {
+    std::filesystem::path base;
+
+    if (const char *xdg = std::getenv("XDG_CACHE_HOME"))
+      base = xdg;
+    else if (const char *home = std::getenv("HOME"))
+      base = std::filesystem::path(home) / ".cache";
+    else
+    {
+      std::error_code ec;
+      base = std::filesystem::temp_directory_path(ec);
+    }
+
+    this->directory = (base / "clwrapper").string();
+  }
+}
+
+void BinaryCache::clear()
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  std::error_code ec;
+  size_t          count = 0;
+
+  for (auto &entry : std::filesystem::directory_iterator(this->directory, ec))
+    if (entry.path().extension() == CACHE_EXTENSION)
+      count += std::filesystem::remove(entry.path(), ec) ? 1 : 0;
+
+  Logger::log()->trace("binary cache: {} entries removed", count);
+}
+
+std::string BinaryCache::compute_key(const std::string &sources,
+                                     const std::string &build_options,
+                                     const cl::Device  &cl_device,
+                                     BinaryType         type) const
+{
+  const std::string fields[] = {sources,
+                                build_options,
+                                cl_device.getInfo<CL_DEVICE_NAME>(),
+                                cl_device.getInfo<CL_DEVICE_VERSION>(),
+                                cl_device.getInfo<CL_DRIVER_VERSION>(),
+                                std::to_string((int)type)};
+
+  // each field is hashed separately and chained so that moving characters
+  // from one field to the next changes the key
+  uint64_t hash = 0;
+  for (auto &s : fields)
+    hash = hash_fnv1a(s.data(), s.size(), hash * 31 + s.size());
+
+  std::ostringstream oss;
+  oss << std::hex;
+  oss.width(16);
+  oss.fill('0');
+  oss << hash;
+  return oss.str();
+}
+
+std::string BinaryCache::get_directory() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->directory;
+}
+
+std::string BinaryCache::get_entry_path(const std::string &key) const
+{
+  return (std::filesystem::path(this->directory) / (key + CACHE_EXTENSION))
+      .string();
+}
+
+BinaryCacheStats BinaryCache::get_stats() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->stats;
+}
+
+void BinaryCache::invalidate(const cl::Device  &cl_device,
+                             const std::string &sources,
+                             const std::string &build_options,
+                             BinaryType         type)
+{
+  const std::string key = this->compute_key(sources,
+                                            build_options,
+                                            cl_device,
+                                            type);
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  Logger::log()->warn("binary cache: entry [{}] invalidated", key);
+  this->remove_entry(key);
+  this->stats.corrupted++;
+
+  // the entry was counted as a hit when loaded
+  if (this->stats.hits > 0) this->stats.hits--;
+  this->stats.misses++;
+}
+
+bool BinaryCache::is_enabled() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->enabled;
+}
+
+bool BinaryCache::load_program(const cl::Context &cl_context,
+                               const cl::Device  &cl_device,
+                               const std::string &sources,
+                               const std::string &build_options,
+                               cl::Program       &program,
+                               BinaryType         type)
+{
+  if (!this->is_enabled()) return false;
+
+  const std::string key = this->compute_key(sources,
+                                            build_options,
+                                            cl_device,
+                                            type);
+
+  std::vector<unsigned char> binary;
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  if (!this->read_entry(key, binary))
+  {
+    Logger::log()->trace("binary cache: miss [{}]", key);
+    this->stats.misses++;
+    return false;
+  }
+
+  // the entry is valid on disk but the driver may still refuse it (e.g.
+  // driver update not reflected in the version string)
+  cl::Program::Binaries binaries = {binary};
+  std::vector<cl_int>   binary_status;
+  cl_int                err = CL_SUCCESS;
+
+  cl::Program cached_program(cl_context,
+                             {cl_device},
+                             binaries,
+                             &binary_status,
+                             &err);
+
+  // compiled objects are used as is by the linker
+  if (err == CL_SUCCESS && type == BinaryType::EXECUTABLE)
+    err = cached_program.build({cl_device}, build_options.c_str());
+
+  if (err != CL_SUCCESS)
+  {
+    Logger::log()->warn("binary cache: entry [{}] rejected by the driver, "
+                        "removing it (error {})",
+                        key,
+                        err);
+    this->remove_entry(key);
+    this->stats.corrupted++;
+    this->stats.misses++;
+    return false;
+  }
+
+  Logger::log()->trace("binary cache: hit [{}]", key);
+  this->stats.hits++;
+  program = cached_program;
+  return true;
+}
+
+void BinaryCache::log_stats() const
+{
+  BinaryCacheStats s = this->get_stats();
+
+  Logger::log()->info("binary cache: hits: {}, misses: {}, stores: {}, "
+                      "corrupted: {}",
+                      s.hits,
+                      s.misses,
+                      s.stores,
+                      s.corrupted);
+}
+
+bool BinaryCache::read_entry(const std::string          &key,
+                             std::vector<unsigned char> &binary)
+{
+  const std::string path = this->get_entry_path(key);
+
+  std::ifstream f(path, std::ios::binary);
+  if (!f.is_open()) return false;
+
+  char     magic[sizeof(CACHE_MAGIC)];
+  uint64_t size = 0;
+  uint64_t checksum = 0;
+
+  f.read(magic, sizeof(magic));
+  f.read(reinterpret_cast<char *>(&size), sizeof(size));
+  f.read(reinterpret_cast<char *>(&checksum), sizeof(checksum));
+
+  bool is_valid = f.good() &&
+                  std::memcmp(magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0;
+
+  if (is_valid)
+  {
+    std::error_code ec;
+    uint64_t        file_size = std::filesystem::file_size(path, ec);
+    uint64_t        header_size = sizeof(CACHE_MAGIC) + 2 * sizeof(uint64_t);
+
+    is_valid = !ec && size > 0 && file_size == header_size + size;
+  }
+
+  if (is_valid)
+  {
+    binary.resize(size);
+    f.read(reinterpret_cast<char *>(binary.data()), size);
+
+    is_valid = f.good() &&
+               hash_fnv1a(binary.data(), binary.size(), CHECKSUM_SEED) ==
+                   checksum;
+  }
+
+  if (!is_valid)
+  {
+    Logger::log()->warn("binary cache: corrupted entry [{}], removing it", key);
+    f.close();
+    this->remove_entry(key);
+    this->stats.corrupted++;
+    binary.clear();
+  }
+
+  return is_valid;
+}
+
+void BinaryCache::remove_entry(const std::string &key)
+{
+  std::error_code ec;
+  std::filesystem::remove(this->get_entry_path(key), ec);
+}
+
+void BinaryCache::reset_stats()
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->stats = BinaryCacheStats();
+}
+
+void BinaryCache::set_directory(const std::string &new_directory)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->directory = new_directory;
+  this->enabled = true;
+}
+
+void BinaryCache::set_enabled(bool new_state)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->enabled = new_state;
+}
+
+bool BinaryCache::store_program(const cl::Device  &cl_device,
+                                const std::string &sources,
+                                const std::string &build_options,
+                                const cl::Program &program,
+                                BinaryType         type)
+{
+  if (!this->is_enabled()) return false;
+
+  cl_int                err = CL_SUCCESS;
+  cl::Program::Binaries binaries = program.getInfo<CL_PROGRAM_BINARIES>(&err);
+
+  // single device programs only
+  if (err != CL_SUCCESS || binaries.size() != 1 || binaries[0].empty())
+  {
+    Logger::log()->warn("binary cache: could not retrieve program binary");
+    return false;
+  }
+
+  const std::string key = this->compute_key(sources,
+                                            build_options,
+                                            cl_device,
+                                            type);
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  if (!this->write_entry(key, binaries[0])) return false;
+
+  Logger::log()->trace("binary cache: stored [{}] ({} bytes)",
+                       key,
+                       binaries[0].size());
+  this->stats.stores++;
+  return true;
+}
+
+bool BinaryCache::write_entry(const std::string                &key,
+                              const std::vector<unsigned char> &binary)
+{
+  std::error_code ec;
+  std::filesystem::create_directories(this->directory, ec);
+
+  if (ec)
+  {
+    Logger::log()->warn("binary cache: could not create directory {}: {}",
+                        this->directory,
+                        ec.message());
+    return false;
+  }
+
+  // write to a unique temporary file and rename it, so that concurrent
+  // processes never read a partially written entry
+  const std::string path = this->get_entry_path(key);
+  std::ostringstream tmp_path;
+  tmp_path << path << ".tmp." << std::hash<std::thread::id>{}(
+                                     std::this_thread::get_id())
+           << "."
+           << std::chrono::steady_clock::now().time_since_epoch().count();
+
+  {
+    std::ofstream f(tmp_path.str(), std::ios::binary | std::ios::trunc);
+
+    uint64_t size = binary.size();
+    uint64_t checksum = hash_fnv1a(binary.data(), binary.size(), CHECKSUM_SEED);
+
+    f.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    f.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    f.write(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+    f.write(reinterpret_cast<const char *>(binary.data()), binary.size());
+
+    if (!f.good())
+    {
+      Logger::log()->warn("binary cache: could not write {}", tmp_path.str());
+      f.close();
+      std::filesystem::remove(tmp_path.str(), ec);
+      return false;
+    }
+  }
+
+  std::filesystem::rename(tmp_path.str(), path, ec);
+
+  if (ec)
+  {
+    std::filesystem::remove(tmp_path.str(), ec);
+    return false;
+  }
+
+  return true;
+}
+
+} // namespace clwrapper
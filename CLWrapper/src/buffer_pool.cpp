@@ -0,0 +1,325 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include "cl_wrapper/buffer_pool.hpp"
+#include "cl_wrapper/logger.hpp"
+
+namespace clwrapper
+{
+
+// objects created from host memory can not be shared
+static const cl_mem_flags NOT_POOLABLE_FLAGS = CL_MEM_USE_HOST_PTR |
+                                               CL_MEM_COPY_HOST_PTR;
+
+cl::Buffer BufferPool::acquire_buffer(const cl::Context &cl_context,
+                                      cl_mem_flags       flags,
+                                      size_t             size,
+                                      int               *p_err)
+{
+  int  err = CL_SUCCESS;
+  bool poolable = (flags & NOT_POOLABLE_FLAGS) == 0;
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (this->enabled && poolable)
+    {
+      size = BufferPool::size_class(size);
+
+      auto it = this->free_buffers.find({cl_context(), flags, size});
+
+      if (it != this->free_buffers.end() && !it->second.empty())
+      {
+        cl::Buffer buffer = it->second.back();
+        it->second.pop_back();
+
+        this->stats.hits++;
+        this->stats.bytes_held -= size;
+        this->stats.objects_held--;
+
+        if (p_err) *p_err = CL_SUCCESS;
+        return buffer;
+      }
+
+      this->stats.misses++;
+    }
+  }
+
+  cl::Buffer buffer(cl_context, flags, size, nullptr, &err);
+  if (p_err) *p_err = err;
+
+  return buffer;
+}
+
+cl::Image2D BufferPool::acquire_image2d(const cl::Context     &cl_context,
+                                        cl_mem_flags           flags,
+                                        const cl::ImageFormat &format,
+                                        size_t                 width,
+                                        size_t                 height,
+                                        int                   *p_err)
+{
+  int  err = CL_SUCCESS;
+  bool poolable = (flags & NOT_POOLABLE_FLAGS) == 0;
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (this->enabled && poolable)
+    {
+      ImageKey key = {cl_context(),
+                      flags,
+                      format.image_channel_order,
+                      format.image_channel_data_type,
+                      width,
+                      height};
+
+      auto it = this->free_images.find(key);
+
+      if (it != this->free_images.end() && !it->second.empty())
+      {
+        cl::Image2D image = it->second.back();
+        it->second.pop_back();
+
+        size_t element_size = 0;
+        clGetImageInfo(image(),
+                       CL_IMAGE_ELEMENT_SIZE,
+                       sizeof(size_t),
+                       &element_size,
+                       nullptr);
+
+        this->stats.hits++;
+        this->stats.bytes_held -= width * height * element_size;
+        this->stats.objects_held--;
+
+        if (p_err) *p_err = CL_SUCCESS;
+        return image;
+      }
+
+      this->stats.misses++;
+    }
+  }
+
+  cl::Image2D image(cl_context,
+                    flags,
+                    format,
+                    width,
+                    height,
+                    0,
+                    nullptr,
+                    &err);
+  if (p_err) *p_err = err;
+
+  return image;
+}
+
+size_t BufferPool::get_high_water_mark() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->high_water_mark;
+}
+
+BufferPoolStats BufferPool::get_stats() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->stats;
+}
+
+bool BufferPool::is_enabled() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->enabled;
+}
+
+void BufferPool::log_stats() const
+{
+  BufferPoolStats s = this->get_stats();
+
+  Logger::log()->info("buffer pool: hits: {}, misses: {}, releases: {}, "
+                      "drops: {}, held: {} objects / {} bytes",
+                      s.hits,
+                      s.misses,
+                      s.releases,
+                      s.drops,
+                      s.objects_held,
+                      s.bytes_held);
+}
+
+void BufferPool::release(const cl::Buffer &buffer)
+{
+  if (!buffer()) return;
+
+  // raw queries, to avoid retaining the context
+  cl_context   context = nullptr;
+  cl_mem_flags flags = 0;
+  size_t       size = 0;
+
+  clGetMemObjectInfo(buffer(),
+                     CL_MEM_CONTEXT,
+                     sizeof(cl_context),
+                     &context,
+                     nullptr);
+  clGetMemObjectInfo(buffer(),
+                     CL_MEM_FLAGS,
+                     sizeof(cl_mem_flags),
+                     &flags,
+                     nullptr);
+  clGetMemObjectInfo(buffer(), CL_MEM_SIZE, sizeof(size_t), &size, nullptr);
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  if (!this->enabled || (flags & NOT_POOLABLE_FLAGS)) return;
+
+  this->stats.releases++;
+
+  // not allocated by the pool
+  if (size != BufferPool::size_class(size)) return;
+
+  if (!this->reserve(size)) return;
+
+  this->free_buffers[{context, flags, size}].push_back(buffer);
+}
+
+void BufferPool::release(const cl::Image2D &image)
+{
+  if (!image()) return;
+
+  cl_context      context = nullptr;
+  cl_mem_flags    flags = 0;
+  cl_image_format format;
+  size_t          width = 0;
+  size_t          height = 0;
+  size_t          element_size = 0;
+
+  clGetMemObjectInfo(image(),
+                     CL_MEM_CONTEXT,
+                     sizeof(cl_context),
+                     &context,
+                     nullptr);
+  clGetMemObjectInfo(image(),
+                     CL_MEM_FLAGS,
+                     sizeof(cl_mem_flags),
+                     &flags,
+                     nullptr);
+  clGetImageInfo(image(),
+                 CL_IMAGE_FORMAT,
+                 sizeof(cl_image_format),
+                 &format,
+                 nullptr);
+  clGetImageInfo(image(), CL_IMAGE_WIDTH, sizeof(size_t), &width, nullptr);
+  clGetImageInfo(image(), CL_IMAGE_HEIGHT, sizeof(size_t), &height, nullptr);
+  clGetImageInfo(image(),
+                 CL_IMAGE_ELEMENT_SIZE,
+                 sizeof(size_t),
+                 &element_size,
+                 nullptr);
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  if (!this->enabled || (flags & NOT_POOLABLE_FLAGS)) return;
+
+  this->stats.releases++;
+
+  if (!this->reserve(width * height * element_size)) return;
+
+  ImageKey key = {context,
+                  flags,
+                  format.image_channel_order,
+                  format.image_channel_data_type,
+                  width,
+                  height};
+
+  this->free_images[key].push_back(image);
+}
+
+bool BufferPool::reserve(size_t size)
+{
+  if (this->stats.bytes_held + size > this->high_water_mark)
+  {
+    this->stats.drops++;
+    return false;
+  }
+
+  this->stats.bytes_held += size;
+  this->stats.objects_held++;
+  return true;
+}
+
+void BufferPool::reset_stats()
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  // held memory is a state, not a counter
+  BufferPoolStats new_stats;
+  new_stats.bytes_held = this->stats.bytes_held;
+  new_stats.objects_held = this->stats.objects_held;
+  this->stats = new_stats;
+}
+
+void BufferPool::set_enabled(bool new_state)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->enabled = new_state;
+  }
+
+  if (!new_state) this->trim();
+}
+
+void BufferPool::set_high_water_mark(size_t new_high_water_mark)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->high_water_mark = new_high_water_mark;
+  }
+
+  this->trim(new_high_water_mark);
+}
+
+size_t BufferPool::size_class(size_t size)
+{
+  const size_t min_size = 256;
+
+  if (size <= min_size) return min_size;
+
+  size_t p = min_size;
+  while (p < size)
+    p <<= 1;
+
+  // 4 steps between p/2 and p
+  size_t step = p / 8;
+  return ((size + step - 1) / step) * step;
+}
+
+void BufferPool::trim(size_t target_bytes)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  for (auto &[key, buffers] : this->free_buffers)
+    while (!buffers.empty() && this->stats.bytes_held > target_bytes)
+    {
+      buffers.pop_back();
+      this->stats.bytes_held -= std::get<2>(key);
+      this->stats.objects_held--;
+    }
+
+  for (auto &[key, images] : this->free_images)
+    while (!images.empty() && this->stats.bytes_held > target_bytes)
+    {
+      size_t element_size = 0;
+      clGetImageInfo(images.back()(),
+                     CL_IMAGE_ELEMENT_SIZE,
+                     sizeof(size_t),
+                     &element_size,
+                     nullptr);
+
+      images.pop_back();
+      this->stats.bytes_held -= std::get<4>(key) * std::get<5>(key) *
+                                element_size;
+      this->stats.objects_held--;
+    }
+
+  Logger::log()->trace("buffer pool trimmed, {} bytes held",
+                       this->stats.bytes_held);
+}
+
+} // namespace clwrapper
@@ -0,0 +1,158 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include "cl_wrapper/device_array.hpp"
+
+namespace clwrapper
+{
+
+DeviceImage::DeviceImage(int            width,
+                         int            height,
+                         cl_mem_flags   flags,
+                         KernelManager &runtime)
+    : host_data(width * height), width(width), height(height), flags(flags),
+      p_runtime(&runtime)
+{
+  this->allocate();
+}
+
+DeviceImage::DeviceImage(const std::vector<float> &vector,
+                         int                       width,
+                         int                       height,
+                         cl_mem_flags              flags,
+                         KernelManager            &runtime)
+    : host_data(vector), width(width), height(height), flags(flags),
+      p_runtime(&runtime)
+{
+  this->allocate();
+  this->is_host_modified = true;
+}
+
+DeviceImage::~DeviceImage()
+{
+  this->wait_upload();
+  BufferPool::get_instance().release(this->cl_image);
+}
+
+void DeviceImage::allocate()
+{
+  int err = CL_SUCCESS;
+  this->cl_image = BufferPool::get_instance().acquire_image2d(
+      this->p_runtime->get_context(),
+      this->flags,
+      cl::ImageFormat(CL_R, CL_FLOAT),
+      this->width,
+      this->height,
+      &err);
+  clerror::throw_opencl_error(err);
+}
+
+void DeviceImage::download()
+{
+  this->wait_upload();
+
+  cl::array<size_t, 3> origin = {0, 0, 0};
+  cl::array<size_t, 3> region = {(size_t)this->width, (size_t)this->height, 1};
+
+  std::vector<cl::Event> wait_list = this->get_write_wait_list();
+
+  int err = this->p_runtime->get_queue().enqueueReadImage(
+      this->cl_image,
+      CL_TRUE,
+      origin,
+      region,
+      0,
+      0,
+      this->host_data.data(),
+      wait_list.empty() ? nullptr : &wait_list);
+  clerror::throw_opencl_error(err);
+
+  this->is_device_modified = false;
+  this->last_write = cl::Event();
+}
+
+std::vector<float> &DeviceImage::edit_host_data()
+{
+  if (this->is_device_modified) this->download();
+  this->wait_upload();
+  this->is_host_modified = true;
+  return this->host_data;
+}
+
+const std::vector<float> &DeviceImage::get_host_data()
+{
+  if (this->is_device_modified) this->download();
+  return this->host_data;
+}
+
+std::vector<cl::Event> DeviceImage::get_write_wait_list() const
+{
+  if (!this->last_write()) return {};
+  return {this->last_write};
+}
+
+void DeviceImage::mark_device_modified(const cl::Event &event)
+{
+  if (this->flags & CL_MEM_READ_ONLY) return;
+
+  this->is_device_modified = true;
+  this->last_write = event;
+}
+
+cl::Event DeviceImage::sync_device(const cl::CommandQueue &queue)
+{
+  // uploaded by a previous launch, maybe not complete yet
+  if (!this->is_host_modified) return this->pending_upload;
+
+  cl::array<size_t, 3> origin = {0, 0, 0};
+  cl::array<size_t, 3> region = {(size_t)this->width, (size_t)this->height, 1};
+
+  std::vector<cl::Event> wait_list = this->get_write_wait_list();
+
+  int err = queue.enqueueWriteImage(this->cl_image,
+                                    CL_FALSE,
+                                    origin,
+                                    region,
+                                    0,
+                                    0,
+                                    this->host_data.data(),
+                                    wait_list.empty() ? nullptr : &wait_list,
+                                    &this->pending_upload);
+  clerror::throw_opencl_error(err);
+
+  this->is_host_modified = false;
+  return this->pending_upload;
+}
+
+void DeviceImage::upload()
+{
+  this->wait_upload();
+
+  cl::array<size_t, 3> origin = {0, 0, 0};
+  cl::array<size_t, 3> region = {(size_t)this->width, (size_t)this->height, 1};
+
+  std::vector<cl::Event> wait_list = this->get_write_wait_list();
+
+  int err = this->p_runtime->get_queue().enqueueWriteImage(
+      this->cl_image,
+      CL_TRUE,
+      origin,
+      region,
+      0,
+      0,
+      this->host_data.data(),
+      wait_list.empty() ? nullptr : &wait_list);
+  clerror::throw_opencl_error(err);
+
+  this->is_host_modified = false;
+}
+
+void DeviceImage::wait_upload()
+{
+  if (!this->pending_upload()) return;
+
+  this->pending_upload.wait();
+  this->pending_upload = cl::Event();
+}
+
+} // namespace clwrapper
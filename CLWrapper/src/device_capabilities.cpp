@@ -0,0 +1,99 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <sstream>
+
+#include "cl_wrapper/device_capabilities.hpp"
+#include "cl_wrapper/svm.hpp"
+
+namespace clwrapper
+{
+
+int DeviceCapabilities::get_opencl_c_version() const
+{
+  // 'OpenCL C <major>.<minor> <vendor specific>'
+  int major = 0;
+  int minor = 0;
+
+  size_t pos = this->opencl_c_version.find_first_of("0123456789");
+
+  if (pos != std::string::npos)
+  {
+    std::istringstream iss(this->opencl_c_version.substr(pos));
+    char               dot;
+    iss >> major >> dot >> minor;
+  }
+
+  return 100 * major + 10 * minor;
+}
+
+bool DeviceCapabilities::has_extension(const std::string &extension) const
+{
+  std::istringstream iss(this->extensions);
+  std::string        word;
+
+  while (iss >> word)
+    if (word == extension) return true;
+
+  return false;
+}
+
+DeviceCapabilities query_device_capabilities(const cl::Device &cl_device)
+{
+  DeviceCapabilities caps;
+
+  caps.name = cl_device.getInfo<CL_DEVICE_NAME>();
+  caps.vendor = cl_device.getInfo<CL_DEVICE_VENDOR>();
+  caps.version = cl_device.getInfo<CL_DEVICE_VERSION>();
+  caps.opencl_c_version = cl_device.getInfo<CL_DEVICE_OPENCL_C_VERSION>();
+  caps.driver_version = cl_device.getInfo<CL_DRIVER_VERSION>();
+  caps.type = cl_device.getInfo<CL_DEVICE_TYPE>();
+
+  caps.compute_units = cl_device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+  caps.clock_frequency = cl_device.getInfo<CL_DEVICE_MAX_CLOCK_FREQUENCY>();
+  caps.max_work_group_size = cl_device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+  for (auto &s : cl_device.getInfo<CL_DEVICE_MAX_WORK_ITEM_SIZES>())
+    caps.max_work_item_sizes.push_back(s);
+
+  caps.global_mem_size = cl_device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>();
+  caps.local_mem_size = cl_device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>();
+  caps.max_mem_alloc_size = cl_device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+  caps.unified_memory = cl_device.getInfo<CL_DEVICE_HOST_UNIFIED_MEMORY>();
+
+  caps.image_support = cl_device.getInfo<CL_DEVICE_IMAGE_SUPPORT>();
+
+  if (caps.image_support)
+  {
+    caps.image2d_max_width = cl_device.getInfo<CL_DEVICE_IMAGE2D_MAX_WIDTH>();
+    caps.image2d_max_height = cl_device.getInfo<CL_DEVICE_IMAGE2D_MAX_HEIGHT>();
+    caps.image3d_max_width = cl_device.getInfo<CL_DEVICE_IMAGE3D_MAX_WIDTH>();
+    caps.image3d_max_height = cl_device.getInfo<CL_DEVICE_IMAGE3D_MAX_HEIGHT>();
+    caps.image3d_max_depth = cl_device.getInfo<CL_DEVICE_IMAGE3D_MAX_DEPTH>();
+    caps.image_max_array_size =
+        cl_device.getInfo<CL_DEVICE_IMAGE_MAX_ARRAY_SIZE>();
+  }
+
+  caps.extensions = cl_device.getInfo<CL_DEVICE_EXTENSIONS>();
+  caps.fp16 = caps.has_extension("cl_khr_fp16");
+  caps.fp64 = caps.has_extension("cl_khr_fp64");
+  caps.svm_capabilities = get_svm_capabilities(cl_device);
+
+  caps.preferred_vector_width_char =
+      cl_device.getInfo<CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR>();
+  caps.preferred_vector_width_short =
+      cl_device.getInfo<CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT>();
+  caps.preferred_vector_width_int =
+      cl_device.getInfo<CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT>();
+  caps.preferred_vector_width_long =
+      cl_device.getInfo<CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG>();
+  caps.preferred_vector_width_half =
+      cl_device.getInfo<CL_DEVICE_PREFERRED_VECTOR_WIDTH_HALF>();
+  caps.preferred_vector_width_float =
+      cl_device.getInfo<CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT>();
+  caps.preferred_vector_width_double =
+      cl_device.getInfo<CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE>();
+
+  return caps;
+}
+
+} // namespace clwrapper
@@ -2,6 +2,7 @@
  * Public License. The full license is in the file LICENSE, distributed with
  * this software. */
 #include <algorithm>
+#include <cstdlib>
 
 #include "cl_wrapper/device_manager.hpp"
 #include "cl_wrapper/logger.hpp"
@@ -22,143 +23,220 @@ bool helper_find_string_insensitive(const std::string &text,
   return (it != text.end());
 }
 
+// vendor based estimate of the device throughput, used when the devices
+// cannot be probed
+static float helper_heuristic_rating(const DeviceCapabilities &caps)
+{
+  // estimate of the number of cores per computational unit for the
+  // platform
+  int cores = 1;
+
+  if (helper_find_string_insensitive(caps.vendor, "nvidia") ||
+      helper_find_string_insensitive(caps.vendor, "amd"))
+    cores = 128;
+  else if (helper_find_string_insensitive(caps.vendor, "intel"))
+    cores = 16;
+
+  return (float)caps.clock_frequency * (float)caps.compute_units * cores;
+}
+
 DeviceManager::DeviceManager()
 {
   Logger::log()->trace("DeviceManager::DeviceManager");
 
-  // initialize the device (example: first GPU)
-  Logger::log()->trace("initializing OpenCL devices...");
+  // selection policy, the vendor heuristic by default
+  DeviceSelection selection = DeviceSelection::HEURISTIC;
+  WorkloadProfile profile = WorkloadProfile::BALANCED;
 
-  std::vector<cl::Platform> platforms;
-  cl::Platform::get(&platforms);
+  if (const char *env_selection = std::getenv("CLWRAPPER_DEVICE_SELECTION"))
+    if (std::string(env_selection) == "benchmark")
+      selection = DeviceSelection::BENCHMARK;
 
-  if (platforms.empty()) throw std::runtime_error("No OpenCL platforms found!");
+  if (const char *env_workload = std::getenv("CLWRAPPER_WORKLOAD"))
+  {
+    if (std::string(env_workload) == "compute")
+      profile = WorkloadProfile::COMPUTE_BOUND;
+    else if (std::string(env_workload) == "memory")
+      profile = WorkloadProfile::MEMORY_BOUND;
+  }
 
-  // select the platform with the most computational resources
-  // (assuming one device / per platform)
-  int platform_index = 0;
-  int flops_best = 0;
+  if (!this->select_device(selection, profile))
+    throw std::runtime_error("No OpenCL devices found!");
 
-  Logger::log()->trace("checking device performances...");
+  log_device_infos(this->cl_device);
+}
 
-  for (size_t kp = 0; kp < platforms.size(); kp++)
-  {
-    Logger::log()->trace("checking platform: {} - {}",
-                         platforms[kp].getInfo<CL_PLATFORM_VENDOR>().c_str(),
-                         platforms[kp].getInfo<CL_PLATFORM_NAME>().c_str());
+void DeviceManager::assign_device(const DeviceInfo &info)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
 
-    std::vector<cl::Device> devices;
-    platforms[kp].getDevices(this->device_type, &devices);
+  this->cl_device = info.cl_device;
+  this->device_id = info.platform_id;
+  this->device_index = info.device_index;
+  this->capabilities = info.capabilities;
+}
 
-    if (devices.empty())
-    {
-      Logger::log()->trace("No OpenCL devices found for this platform");
-    }
-    else
-    {
-      // estimate of the number of cores per computational unit for the
-      // platform
-      std::string vendor = devices[0].getInfo<CL_DEVICE_VENDOR>();
-      int         cores = 1;
-
-      if (helper_find_string_insensitive(vendor, "nvidia") ||
-          helper_find_string_insensitive(vendor, "amd"))
-        cores = 128;
-      else if (helper_find_string_insensitive(vendor, "intel"))
-        cores = 16;
-
-      int flops = (int)devices[0].getInfo<CL_DEVICE_MAX_CLOCK_FREQUENCY>() *
-                  (int)devices[0].getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>() *
-                  cores;
-
-      if (flops > flops_best)
-      {
-        flops_best = flops;
-        platform_index = kp;
-      }
+std::map<size_t, std::string> DeviceManager::get_available_devices()
+{
+  std::map<size_t, std::string> device_map = {};
 
-      Logger::log()->trace("rating - device: {}, vendor: {}, rating: {}",
-                           devices[0].getInfo<CL_DEVICE_NAME>().c_str(),
-                           vendor.c_str(),
-                           flops);
-    }
-  }
+  // first device of each platform
+  for (auto &info : this->get_devices())
+    if (info.device_index == 0) device_map[info.platform_id] = info.name;
 
-  // eventually assign the platform / device
-  std::vector<cl::Device> devices;
-  platforms[platform_index].getDevices(this->device_type, &devices);
-  this->cl_device = devices[0];
-  this->device_id = platform_index;
+  return device_map;
+}
 
-  Logger::log()->info("Selected OpenCL device: {}",
-                      this->cl_device.getInfo<CL_DEVICE_NAME>().c_str());
+DeviceCapabilities DeviceManager::get_capabilities() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->capabilities;
+}
 
-  log_device_infos(this->cl_device);
+cl::Device DeviceManager::get_device() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->cl_device;
 }
 
-std::map<size_t, std::string> DeviceManager::get_available_devices()
+std::vector<DeviceInfo> DeviceManager::get_devices()
 {
-  std::map<size_t, std::string> device_map = {};
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  if (this->is_enumerated) return this->devices;
 
   std::vector<cl::Platform> platforms;
   cl::Platform::get(&platforms);
 
   if (platforms.empty()) throw std::runtime_error("No OpenCL platforms found!");
 
+  this->devices.clear();
+
   for (size_t kp = 0; kp < platforms.size(); kp++)
   {
-    std::vector<cl::Device> devices;
-    platforms[kp].getDevices(this->device_type, &devices);
+    Logger::log()->trace("checking platform: {} - {}",
+                         platforms[kp].getInfo<CL_PLATFORM_VENDOR>().c_str(),
+                         platforms[kp].getInfo<CL_PLATFORM_NAME>().c_str());
 
-    if (devices.empty())
-    {
+    std::vector<cl::Device> platform_devices;
+    platforms[kp].getDevices(this->device_type, &platform_devices);
+
+    if (platform_devices.empty())
       Logger::log()->trace("No OpenCL devices found for this platform");
-    }
-    else
+
+    for (size_t kd = 0; kd < platform_devices.size(); kd++)
     {
-      std::string name = platforms[kp].getInfo<CL_PLATFORM_VENDOR>() + "/" +
-                         platforms[kp].getInfo<CL_PLATFORM_NAME>() + "/" +
-                         devices[0].getInfo<CL_DEVICE_NAME>();
+      DeviceInfo info;
+
+      info.platform_id = kp;
+      info.device_index = kd;
+      info.cl_device = platform_devices[kd];
+      info.capabilities = query_device_capabilities(platform_devices[kd]);
+      info.name = platforms[kp].getInfo<CL_PLATFORM_VENDOR>() + "/" +
+                  platforms[kp].getInfo<CL_PLATFORM_NAME>() + "/" +
+                  info.capabilities.name;
 
-      device_map[kp] = name;
+      this->devices.push_back(info);
     }
   }
 
-  return device_map;
-}
+  this->is_enumerated = true;
 
-cl::Device DeviceManager::get_device() const
-{
-  return this->cl_device;
+  return this->devices;
 }
 
-bool DeviceManager::set_device(size_t platform_id)
+bool DeviceManager::select_device(DeviceSelection selection,
+                                  WorkloadProfile profile)
 {
-  std::vector<cl::Platform> platforms;
-  cl::Platform::get(&platforms);
+  Logger::log()->trace("initializing OpenCL devices...");
 
-  if (platforms.empty()) throw std::runtime_error("No OpenCL platforms found!");
+  // every device of every platform
+  std::vector<DeviceInfo> candidates = this->get_devices();
+
+  if (candidates.empty()) return false;
 
-  std::vector<cl::Device> devices;
-  platforms[platform_id].getDevices(this->device_type, &devices);
+  // negative for the devices left out of the selection
+  std::vector<float> ratings(candidates.size(), -1.f);
 
-  if (devices.empty())
+  if (selection == DeviceSelection::BENCHMARK)
   {
-    Logger::log()->error("No OpenCL devices found for this platform");
-    return false;
+    Logger::log()->trace("benchmarking devices...");
+
+    for (size_t k = 0; k < candidates.size(); k++)
+    {
+      DeviceRating rating = DeviceRatings::get_instance().get_rating(
+          candidates[k].cl_device);
+
+      // scores are not comparable if any device could not be probed
+      if (!rating.is_valid())
+      {
+        Logger::log()->warn("device benchmark failed, falling back to the "
+                            "vendor heuristic");
+        selection = DeviceSelection::HEURISTIC;
+        break;
+      }
+
+      ratings[k] = rating.score(profile);
+    }
   }
-  else
-  {
-    this->cl_device = devices[0];
-    this->device_id = platform_id;
 
-    Logger::log()->trace("OpenCL device: {}",
-                         this->cl_device.getInfo<CL_DEVICE_NAME>().c_str());
+  if (selection == DeviceSelection::HEURISTIC)
+  {
+    Logger::log()->trace("checking device performances...");
+
+    // first device of each platform only (assuming one device per
+    // platform), benchmarks are needed to rank the other devices
+    for (size_t k = 0; k < candidates.size(); k++)
+      ratings[k] = candidates[k].device_index == 0
+                       ? helper_heuristic_rating(candidates[k].capabilities)
+                       : -1.f;
   }
 
+  for (size_t k = 0; k < candidates.size(); k++)
+    if (ratings[k] >= 0.f)
+      Logger::log()->trace("rating - device: {}, vendor: {}, rating: {}",
+                           candidates[k].capabilities.name.c_str(),
+                           candidates[k].capabilities.vendor.c_str(),
+                           ratings[k]);
+
+  size_t best = std::max_element(ratings.begin(), ratings.end()) -
+                ratings.begin();
+
+  // eventually assign the platform / device
+  this->assign_device(candidates[best]);
+
+  Logger::log()->info("Selected OpenCL device: {}",
+                      candidates[best].capabilities.name.c_str());
+
   return true;
 }
 
+bool DeviceManager::set_device(size_t platform_id, size_t device_index)
+{
+  for (auto &info : this->get_devices())
+    if (info.platform_id == platform_id && info.device_index == device_index)
+    {
+      this->assign_device(info);
+
+      Logger::log()->trace("OpenCL device: {}", info.capabilities.name);
+      return true;
+    }
+
+  Logger::log()->error("No OpenCL device {} found for the platform {}",
+                       device_index,
+                       platform_id);
+  return false;
+}
+
+void DeviceManager::set_device_type(cl_device_type new_device_type)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  // enumerated again at the next query
+  this->device_type = new_device_type;
+  this->is_enumerated = false;
+}
+
 void log_device_infos(cl::Device cl_device)
 {
   Logger::log()->info("- device Name: {}",
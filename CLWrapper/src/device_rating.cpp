@@ -0,0 +1,305 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "cl_error_lookup.hpp"
+
+#include "cl_wrapper/binary_cache.hpp"
+#include "cl_wrapper/device_rating.hpp"
+#include "cl_wrapper/event.hpp"
+#include "cl_wrapper/logger.hpp"
+
+namespace clwrapper
+{
+
+static const std::string PROBE_CODE = R""(
+kernel void probe_copy(global const float4 *src, global float4 *dst)
+{
+  const uint i = get_global_id(0);
+  dst[i] = src[i];
+}
+
+kernel void probe_mad(global float *out, const float a, const int n)
+{
+  const uint i = get_global_id(0);
+
+  float x = (float)i * 1e-6f;
+  float y = 1.f;
+
+  for (int k = 0; k < n; k++)
+  {
+    x = mad(x, a, y);
+    y = mad(y, a, x);
+  }
+
+  out[i] = x + y;
+}
+)"";
+
+// copied bytes, limited by the maximum allocation size
+static const size_t PROBE_COPY_BYTES = 64 << 20;
+
+// multiply-add loop length and work-items per compute unit
+static const int PROBE_MAD_ITERATIONS = 1024;
+static const int PROBE_MAD_ITEMS_PER_UNIT = 4096;
+
+// timed launches of each probe, the best one is kept
+static const int PROBE_REPEATS = 3;
+
+// best execution time (ms) of the kernel over the repeats, after a warm-up
+static float helper_time_kernel(const cl::CommandQueue &queue,
+                                const cl::Kernel       &kernel,
+                                size_t                  global_size)
+{
+  float best_time = 0.f;
+
+  for (int r = 0; r <= PROBE_REPEATS; r++)
+  {
+    cl::Event cl_event;
+
+    int err = queue.enqueueNDRangeKernel(kernel,
+                                         cl::NullRange,
+                                         cl::NDRange(global_size),
+                                         cl::NullRange,
+                                         nullptr,
+                                         &cl_event);
+    clerror::throw_opencl_error(err);
+
+    cl_event.wait();
+
+    float time = Event(cl_event).get_timing().get_execution_time();
+    if (r > 0 && (r == 1 || time < best_time)) best_time = time;
+  }
+
+  return best_time;
+}
+
+float DeviceRating::score(WorkloadProfile profile) const
+{
+  switch (profile)
+  {
+  case WorkloadProfile::COMPUTE_BOUND: return this->gflops;
+  case WorkloadProfile::MEMORY_BOUND: return this->bandwidth;
+  default: return std::sqrt(this->gflops * this->bandwidth);
+  }
+}
+
+DeviceRatings::DeviceRatings()
+{
+  if (const char *env_file = std::getenv("CLWRAPPER_RATINGS_FILE"))
+    this->file_path = env_file;
+  else
+    this->file_path = (std::filesystem::path(
+                           BinaryCache::get_instance().get_directory()) /
+                       "ratings.txt")
+                          .string();
+}
+
+void DeviceRatings::clear()
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->entries.clear();
+  this->is_loaded = true;
+
+  std::error_code ec;
+  std::filesystem::remove(this->file_path, ec);
+}
+
+std::string DeviceRatings::get_file_path() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->file_path;
+}
+
+DeviceRating DeviceRatings::get_rating(const cl::Device &cl_device)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  if (!this->is_loaded) this->load();
+
+  const std::string key = get_device_signature(cl_device);
+
+  auto it = this->entries.find(key);
+  if (it != this->entries.end()) return it->second;
+
+  DeviceRating rating = this->measure(cl_device);
+
+  // failed probes are not stored, they are tried again at the next run
+  if (rating.is_valid())
+  {
+    this->entries[key] = rating;
+    this->save();
+  }
+
+  return rating;
+}
+
+void DeviceRatings::load()
+{
+  this->entries.clear();
+  this->is_loaded = true;
+
+  std::ifstream f(this->file_path);
+  if (!f.is_open()) return;
+
+  std::string line;
+
+  while (std::getline(f, line))
+  {
+    if (line.empty() || line[0] == '#') continue;
+
+    std::istringstream iss(line);
+    std::string        key;
+    DeviceRating       rating;
+
+    if (iss >> key >> rating.bandwidth >> rating.gflops && rating.is_valid())
+      this->entries[key] = rating;
+  }
+
+  Logger::log()->trace("device ratings: {} entries loaded from {}",
+                       this->entries.size(),
+                       this->file_path);
+}
+
+DeviceRating DeviceRatings::measure(const cl::Device &cl_device) const
+{
+  DeviceRating rating;
+  std::string  name = cl_device.getInfo<CL_DEVICE_NAME>();
+
+  Logger::log()->trace("device ratings: probing {}...", name);
+
+  try
+  {
+    int err = 0;
+
+    cl::Context      context(cl_device, nullptr, nullptr, nullptr, &err);
+    cl::CommandQueue queue(context,
+                           cl_device,
+                           CL_QUEUE_PROFILING_ENABLE,
+                           &err);
+    clerror::throw_opencl_error(err);
+
+    cl::Program program(context, PROBE_CODE, false, &err);
+    clerror::throw_opencl_error(err);
+
+    err = program.build({cl_device});
+    clerror::throw_opencl_error(err);
+
+    // bandwidth, read + write of the copied bytes
+    size_t bytes = std::min(PROBE_COPY_BYTES,
+                            (size_t)cl_device
+                                .getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>());
+    bytes -= bytes % (16 * 256);
+
+    cl::Buffer src(context, CL_MEM_READ_ONLY, bytes, nullptr, &err);
+    clerror::throw_opencl_error(err);
+    cl::Buffer dst(context, CL_MEM_WRITE_ONLY, bytes, nullptr, &err);
+    clerror::throw_opencl_error(err);
+
+    cl::Kernel copy_kernel(program, "probe_copy", &err);
+    clerror::throw_opencl_error(err);
+    copy_kernel.setArg(0, src);
+    copy_kernel.setArg(1, dst);
+
+    float copy_time = helper_time_kernel(queue, copy_kernel, bytes / 16);
+
+    if (copy_time > 0.f) rating.bandwidth = 2.f * bytes / copy_time * 1e-6f;
+
+    // FLOPS, two multiply-adds per iteration
+    size_t global_size = (size_t)PROBE_MAD_ITEMS_PER_UNIT *
+                         cl_device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+
+    cl::Buffer out(context,
+                   CL_MEM_WRITE_ONLY,
+                   global_size * sizeof(float),
+                   nullptr,
+                   &err);
+    clerror::throw_opencl_error(err);
+
+    cl::Kernel mad_kernel(program, "probe_mad", &err);
+    clerror::throw_opencl_error(err);
+    mad_kernel.setArg(0, out);
+    mad_kernel.setArg(1, 0.999f);
+    mad_kernel.setArg(2, PROBE_MAD_ITERATIONS);
+
+    float mad_time = helper_time_kernel(queue, mad_kernel, global_size);
+
+    if (mad_time > 0.f)
+      rating.gflops = 4.f * PROBE_MAD_ITERATIONS * global_size / mad_time *
+                      1e-6f;
+  }
+  catch (const std::exception &e)
+  {
+    Logger::log()->warn("device ratings: probes failed on {}: {}",
+                        name,
+                        e.what());
+    return DeviceRating();
+  }
+
+  Logger::log()->trace("device ratings: {}, bandwidth: {:.1f} GB/s, "
+                       "compute: {:.1f} GFLOPS",
+                       name,
+                       rating.bandwidth,
+                       rating.gflops);
+
+  return rating;
+}
+
+void DeviceRatings::save() const
+{
+  std::error_code       ec;
+  std::filesystem::path path(this->file_path);
+
+  if (path.has_parent_path())
+    std::filesystem::create_directories(path.parent_path(), ec);
+
+  // written aside and renamed, the file is never seen partially written
+  const std::string tmp_path = this->file_path + ".tmp";
+
+  {
+    std::ofstream f(tmp_path, std::ios::trunc);
+
+    f << "# clwrapper device ratings: signature bandwidth(GB/s) gflops\n";
+
+    for (auto &[key, rating] : this->entries)
+      f << key << " " << rating.bandwidth << " " << rating.gflops << "\n";
+
+    if (!f.good())
+    {
+      Logger::log()->warn("device ratings: could not write {}", tmp_path);
+      f.close();
+      std::filesystem::remove(tmp_path, ec);
+      return;
+    }
+  }
+
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) std::filesystem::remove(tmp_path, ec);
+}
+
+void DeviceRatings::set_file_path(const std::string &new_file_path)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->file_path = new_file_path;
+  this->load();
+}
+
+std::string get_device_signature(const cl::Device &cl_device)
+{
+  const std::string s = cl_device.getInfo<CL_DEVICE_NAME>() + ";" +
+                        cl_device.getInfo<CL_DEVICE_VERSION>() + ";" +
+                        cl_device.getInfo<CL_DRIVER_VERSION>();
+
+  std::ostringstream oss;
+  oss << std::hex << hash_fnv1a(s.data(), s.size());
+  return oss.str();
+}
+
+} // namespace clwrapper
@@ -0,0 +1,43 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <algorithm>
+
+#include "cl_wrapper/dirty_ranges.hpp"
+
+namespace clwrapper
+{
+
+void DirtyRanges::add(size_t offset, size_t size)
+{
+  if (size > 0) this->ranges.push_back({offset, size});
+}
+
+std::vector<std::pair<size_t, size_t>> DirtyRanges::coalesce(size_t gap) const
+{
+  std::vector<std::pair<size_t, size_t>> sorted = this->ranges;
+  std::sort(sorted.begin(), sorted.end());
+
+  std::vector<std::pair<size_t, size_t>> merged = {};
+
+  for (auto &[offset, size] : sorted)
+  {
+    if (!merged.empty())
+    {
+      size_t end = merged.back().first + merged.back().second;
+
+      if (offset <= end + gap)
+      {
+        merged.back().second = std::max(end, offset + size) -
+                               merged.back().first;
+        continue;
+      }
+    }
+
+    merged.push_back({offset, size});
+  }
+
+  return merged;
+}
+
+} // namespace clwrapper
@@ -0,0 +1,105 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include "cl_error_lookup.hpp"
+
+#include "cl_wrapper/event.hpp"
+#include "cl_wrapper/logger.hpp"
+
+namespace clwrapper
+{
+
+void CL_CALLBACK helper_event_callback(cl_event, cl_int status, void *data)
+{
+  auto *p_callback = static_cast<std::function<void()> *>(data);
+
+  if (status < 0)
+    Logger::log()->error("command terminated with error status: {}", status);
+
+  (*p_callback)();
+  delete p_callback;
+}
+
+EventTiming Event::get_timing() const
+{
+  EventTiming timing;
+
+  if (!this->is_valid()) return timing;
+
+  int err = CL_SUCCESS;
+
+  const cl::Event &e = this->cl_event;
+
+  // not available if the queue has no profiling enabled
+  timing.queued = e.getProfilingInfo<CL_PROFILING_COMMAND_QUEUED>(&err);
+  if (err != CL_SUCCESS) return EventTiming();
+
+  timing.submit = e.getProfilingInfo<CL_PROFILING_COMMAND_SUBMIT>();
+  timing.start = e.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+  timing.end = e.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+
+  return timing;
+}
+
+bool Event::is_complete() const
+{
+  if (!this->is_valid()) return true;
+
+  cl_int status = this->cl_event
+                      .getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>();
+  return status == CL_COMPLETE || status < 0;
+}
+
+Event &Event::then(std::function<void()> callback)
+{
+  if (!this->is_valid())
+  {
+    callback();
+    return *this;
+  }
+
+  auto *p_callback = new std::function<void()>(std::move(callback));
+
+  int err = this->cl_event.setCallback(CL_COMPLETE,
+                                       helper_event_callback,
+                                       p_callback);
+
+  if (err != CL_SUCCESS)
+  {
+    delete p_callback;
+    clerror::throw_opencl_error(err);
+  }
+
+  return *this;
+}
+
+void Event::wait() const
+{
+  if (!this->is_valid()) return;
+
+  int err = this->cl_event.wait();
+  clerror::throw_opencl_error(err);
+}
+
+std::vector<cl::Event> to_cl_events(const std::vector<Event> &wait_list)
+{
+  std::vector<cl::Event> cl_events = {};
+  cl_events.reserve(wait_list.size());
+
+  for (auto &e : wait_list)
+    if (e.is_valid()) cl_events.push_back(e.get_event());
+
+  return cl_events;
+}
+
+void wait_for_events(const std::vector<Event> &events)
+{
+  std::vector<cl::Event> cl_events = to_cl_events(events);
+
+  if (cl_events.empty()) return;
+
+  int err = cl::WaitForEvents(cl_events);
+  clerror::throw_opencl_error(err);
+}
+
+} // namespace clwrapper
@@ -0,0 +1,341 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <algorithm>
+#include <cstdlib>
+
+#include "cl_wrapper/device_manager.hpp"
+#include "cl_wrapper/host_backend.hpp"
+#include "cl_wrapper/logger.hpp"
+
+namespace clwrapper
+{
+
+// --- HostArgs
+
+const HostArgs::Arg &HostArgs::get_arg(size_t index) const
+{
+  if (index >= this->args.size())
+    throw std::invalid_argument("host kernel argument " +
+                                std::to_string(index) + " not bound");
+
+  return this->args[index];
+}
+
+HostArgs::Arg &HostArgs::get_or_create_arg(size_t index)
+{
+  if (index >= this->args.size()) this->args.resize(index + 1);
+  return this->args[index];
+}
+
+size_t HostArgs::get_size(size_t index) const
+{
+  return this->get_arg(index).size;
+}
+
+void HostArgs::set_pointer(size_t index, void *ptr, size_t size)
+{
+  Arg &arg = this->get_or_create_arg(index);
+
+  arg.ptr = ptr;
+  arg.size = size;
+  arg.bytes.clear();
+}
+
+void HostArgs::set_value(size_t index, const void *ptr, size_t size)
+{
+  Arg &arg = this->get_or_create_arg(index);
+
+  arg.ptr = nullptr;
+  arg.size = size;
+  arg.bytes.assign(static_cast<const char *>(ptr),
+                   static_cast<const char *>(ptr) + size);
+}
+
+// --- ThreadPool
+
+ThreadPool::ThreadPool(size_t thread_count)
+{
+  thread_count = std::max((size_t)1, thread_count);
+
+  for (size_t k = 0; k < thread_count; k++)
+    this->queues.push_back(std::make_unique<WorkQueue>());
+
+  for (size_t k = 0; k + 1 < thread_count; k++)
+    this->threads.emplace_back(&ThreadPool::worker_loop, this, k);
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->is_stopping = true;
+  }
+
+  this->cv_work.notify_all();
+
+  for (auto &thread : this->threads)
+    thread.join();
+}
+
+void ThreadPool::parallel_for(size_t                             task_count,
+                              const std::function<void(size_t)> &fct)
+{
+  if (task_count == 0) return;
+
+  std::lock_guard<std::mutex> call_lock(this->call_mutex);
+
+  // set before the tasks are queued, workers still looking for tasks of the
+  // previous call may pick the new ones
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    this->p_fct = &fct;
+    this->remaining = task_count;
+    this->exception = nullptr;
+  }
+
+  // contiguous blocks, neighbouring tasks run on the same thread
+  size_t n_queues = this->queues.size();
+
+  for (size_t q = 0; q < n_queues; q++)
+  {
+    std::lock_guard<std::mutex> lock(this->queues[q]->mutex);
+
+    for (size_t k = task_count * q / n_queues;
+         k < task_count * (q + 1) / n_queues;
+         k++)
+      this->queues[q]->tasks.push_back(k);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->generation++;
+  }
+
+  this->cv_work.notify_all();
+
+  while (this->run_task(n_queues - 1))
+    ;
+
+  {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->cv_done.wait(lock, [this]() { return this->remaining == 0; });
+    this->p_fct = nullptr;
+  }
+
+  if (this->exception) std::rethrow_exception(this->exception);
+}
+
+bool ThreadPool::run_task(size_t queue_index)
+{
+  size_t n_queues = this->queues.size();
+  size_t task = 0;
+  bool   is_found = false;
+
+  // own queue first (front), then steal from the others (back)
+  for (size_t k = 0; k < n_queues && !is_found; k++)
+  {
+    WorkQueue                  &queue = *this->queues[(queue_index + k) %
+                                                     n_queues];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+
+    if (queue.tasks.empty()) continue;
+
+    if (k == 0)
+    {
+      task = queue.tasks.front();
+      queue.tasks.pop_front();
+    }
+    else
+    {
+      task = queue.tasks.back();
+      queue.tasks.pop_back();
+    }
+
+    is_found = true;
+  }
+
+  if (!is_found) return false;
+
+  try
+  {
+    (*this->p_fct)(task);
+  }
+  catch (...)
+  {
+    std::lock_guard<std::mutex> lock(this->exception_mutex);
+    if (!this->exception) this->exception = std::current_exception();
+  }
+
+  if (--this->remaining == 0)
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->cv_done.notify_all();
+  }
+
+  return true;
+}
+
+void ThreadPool::worker_loop(size_t queue_index)
+{
+  size_t generation_done = 0;
+
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->cv_work.wait(lock,
+                         [this, generation_done]() {
+                           return this->is_stopping ||
+                                  this->generation != generation_done;
+                         });
+
+      if (this->is_stopping) return;
+
+      generation_done = this->generation;
+    }
+
+    while (this->run_task(queue_index))
+      ;
+  }
+}
+
+// --- HostBackend
+
+HostBackend::HostBackend()
+{
+  this->thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+  if (const char *env_threads = std::getenv("CLWRAPPER_HOST_THREADS"))
+    this->thread_count = std::max(1, std::atoi(env_threads));
+
+  if (const char *env_host = std::getenv("CLWRAPPER_HOST_BACKEND"))
+    this->forced = std::string(env_host) != "0";
+}
+
+void HostBackend::add_kernel(const std::string &kernel_name, HostKernel kernel)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->kernels[kernel_name] = kernel;
+
+  Logger::log()->trace("host kernel added: {}", kernel_name);
+}
+
+void HostBackend::execute(const std::string         &kernel_name,
+                          const std::vector<size_t> &global_size,
+                          const HostArgs            &args)
+{
+  HostKernel                  kernel;
+  std::shared_ptr<ThreadPool> pool;
+  size_t                      chunk;
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    auto it = this->kernels.find(kernel_name);
+
+    if (it == this->kernels.end())
+    {
+      Logger::log()->error("unknown host kernel: [{}]", kernel_name);
+      throw std::invalid_argument("unknown host kernel: " + kernel_name);
+    }
+
+    if (!this->pool)
+      this->pool = std::make_shared<ThreadPool>(this->thread_count);
+
+    kernel = it->second;
+    pool = this->pool;
+    chunk = this->chunk_size;
+  }
+
+  size_t nx = global_size.empty() ? 0 : global_size[0];
+  size_t ny = global_size.size() > 1 ? global_size[1] : 1;
+
+  // chunks do not span several rows
+  size_t chunks_per_row = (nx + chunk - 1) / chunk;
+
+  pool->parallel_for(chunks_per_row * ny,
+                     [&](size_t task)
+                     {
+                       HostRange range;
+
+                       range.begin = (task % chunks_per_row) * chunk;
+                       range.end = std::min(nx, range.begin + chunk);
+                       range.y = task / chunks_per_row;
+                       range.global_size = {nx, ny};
+
+                       kernel(range, args);
+                     });
+}
+
+size_t HostBackend::get_chunk_size() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->chunk_size;
+}
+
+size_t HostBackend::get_thread_count() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->thread_count;
+}
+
+bool HostBackend::has_kernel(const std::string &kernel_name) const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->kernels.find(kernel_name) != this->kernels.end();
+}
+
+bool HostBackend::is_forced() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->forced;
+}
+
+bool HostBackend::is_used(const std::string &kernel_name)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  if (this->kernels.find(kernel_name) == this->kernels.end()) return false;
+
+  if (this->forced) return true;
+
+  if (!this->is_opencl_checked)
+  {
+    this->is_opencl_available = DeviceManager::is_ready();
+    this->is_opencl_checked = true;
+
+    if (!this->is_opencl_available)
+      Logger::log()->warn("OpenCL not available, using the host kernels");
+  }
+
+  return !this->is_opencl_available;
+}
+
+void HostBackend::set_chunk_size(size_t new_chunk_size)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->chunk_size = std::max((size_t)1, (new_chunk_size +
+                                          HOST_CHUNK_MULTIPLE - 1) /
+                                             HOST_CHUNK_MULTIPLE) *
+                     HOST_CHUNK_MULTIPLE;
+}
+
+void HostBackend::set_forced(bool new_state)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->forced = new_state;
+}
+
+void HostBackend::set_thread_count(size_t new_thread_count)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->thread_count = std::max((size_t)1, new_thread_count);
+  this->pool.reset();
+}
+
+} // namespace clwrapper
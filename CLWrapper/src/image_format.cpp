@@ -0,0 +1,80 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include "cl_wrapper/image_format.hpp"
+
+namespace clwrapper
+{
+
+size_t channel_count(cl_channel_order order)
+{
+  switch (order)
+  {
+  case CL_R:
+  case CL_A:
+  case CL_INTENSITY:
+  case CL_LUMINANCE: return 1;
+  case CL_RG: return 2;
+  case CL_RGB: return 3;
+  case CL_RGBA:
+  case CL_BGRA: return 4;
+  default: return 0;
+  }
+}
+
+size_t channel_type_size(cl_channel_type type)
+{
+  switch (type)
+  {
+  case CL_SNORM_INT8:
+  case CL_UNORM_INT8:
+  case CL_SIGNED_INT8:
+  case CL_UNSIGNED_INT8: return 1;
+  case CL_SNORM_INT16:
+  case CL_UNORM_INT16:
+  case CL_SIGNED_INT16:
+  case CL_UNSIGNED_INT16:
+  case CL_HALF_FLOAT: return 2;
+  case CL_SIGNED_INT32:
+  case CL_UNSIGNED_INT32:
+  case CL_FLOAT: return 4;
+  default: return 0;
+  }
+}
+
+bool is_image_format_supported(const cl::Context     &context,
+                               cl_mem_flags           flags,
+                               cl_mem_object_type     type,
+                               const cl::ImageFormat &format)
+{
+  using Key = std::tuple<cl_context, cl_mem_flags, cl_mem_object_type>;
+
+  static std::map<Key, std::vector<cl::ImageFormat>> cache;
+  static std::mutex                                  mutex;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  Key  key = {context(), flags, type};
+  auto it = cache.find(key);
+
+  if (it == cache.end())
+  {
+    std::vector<cl::ImageFormat> formats;
+    context.getSupportedImageFormats(flags, type, &formats);
+    it = cache.emplace(key, formats).first;
+  }
+
+  for (auto &f : it->second)
+    if (f.image_channel_order == format.image_channel_order &&
+        f.image_channel_data_type == format.image_channel_data_type)
+      return true;
+
+  return false;
+}
+
+} // namespace clwrapper
@@ -1,79 +1,734 @@
 /* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
  * Public License. The full license is in the file LICENSE, distributed with
  * this software. */
-#include <iostream>
+#include <algorithm>
+#include <regex>
+#include <sstream>
 
 #include "cl_error_lookup.hpp"
 
+#include "cl_wrapper/binary_cache.hpp"
 #include "cl_wrapper/device_manager.hpp"
 #include "cl_wrapper/kernel_manager.hpp"
 #include "cl_wrapper/logger.hpp"
 
-#include <iostream>
-
 namespace clwrapper
 {
 
+// only a subset of the build options is accepted by clLinkProgram
+std::string helper_extract_link_options(const std::string &build_options)
+{
+  const std::vector<std::string> link_options = {
+      "-cl-denorms-are-zero",
+      "-cl-no-signed-zeros",
+      "-cl-unsafe-math-optimizations",
+      "-cl-finite-math-only",
+      "-cl-fast-relaxed-math"};
+
+  std::istringstream iss(build_options);
+  std::string        option;
+  std::string        options = "";
+
+  while (iss >> option)
+    for (auto &lo : link_options)
+      if (option == lo) options += (options.empty() ? "" : " ") + option;
+
+  return options;
+}
+
+std::vector<std::string> helper_split_kernel_names(const std::string &names)
+{
+  std::vector<std::string> list = {};
+  std::istringstream       iss(names);
+  std::string              name;
+
+  while (std::getline(iss, name, ';'))
+    if (!name.empty()) list.push_back(name);
+
+  return list;
+}
+
+// kernel names found in the sources, used to locate kernels of modules not
+// built yet
+std::vector<std::string> helper_scan_kernel_names(const std::string &sources)
+{
+  // remove comments
+  static const std::regex re_comments(R"(/\*[\s\S]*?\*/|//[^\n]*)");
+  const std::string       code = std::regex_replace(sources, re_comments, " ");
+
+  // [attributes] (__)kernel [attributes] void [attributes] name(, with
+  // any whitespace (including newlines) in between and attributes such as
+  // __attribute__((reqd_work_group_size(16, 16, 1)))
+  static const std::string attribute =
+      R"((?:__attribute__\s*\(\()"
+      R"((?:[^()]|\((?:[^()]|\([^()]*\))*\))*\)\)\s*)*)";
+
+  static const std::regex re_kernel(R"(\b(?:__kernel|kernel)\s+)" +
+                                    attribute + R"(void\s+)" + attribute +
+                                    R"((\w+)\s*\()");
+
+  std::vector<std::string> names = {};
+
+  for (auto it = std::sregex_iterator(code.begin(), code.end(), re_kernel);
+       it != std::sregex_iterator();
+       ++it)
+    names.push_back((*it)[1].str());
+
+  return names;
+}
+
+void helper_build_module(const cl::Context &cl_context,
+                         const cl::Device  &cl_device,
+                         const std::string &sources,
+                         const std::string &build_options,
+                         bool               use_cache,
+                         cl::Program       &cl_object,
+                         cl::Program       &cl_program)
+{
+  BinaryCache &cache = BinaryCache::get_instance();
+  int          err = CL_SUCCESS;
+
+  // compile, or reuse a previously compiled object if available
+  bool from_cache = use_cache &&
+                    cache.load_program(cl_context,
+                                       cl_device,
+                                       sources,
+                                       build_options,
+                                       cl_object,
+                                       BinaryType::COMPILED_OBJECT);
+
+  if (!from_cache)
+  {
+    Logger::log()->trace("compiling OpenCL kernels");
+    Logger::log()->trace("build options: {}", build_options);
+
+    cl::Program::Sources cl_sources;
+    cl_sources.push_back({sources.c_str(), sources.length()});
+
+    cl_object = cl::Program(cl_context, cl_sources);
+    err = cl_object.compile(build_options.c_str());
+
+    if (err != CL_SUCCESS)
+    {
+      Logger::log()->critical("build error");
+      throw BuildError("Error building, OpenCL compiler says:",
+                       cl_object.getBuildInfo<CL_PROGRAM_BUILD_LOG>(cl_device),
+                       err);
+    }
+
+    cache.store_program(cl_device,
+                        sources,
+                        build_options,
+                        cl_object,
+                        BinaryType::COMPILED_OBJECT);
+  }
+
+  // link the module on its own
+  const std::string link_options = helper_extract_link_options(build_options);
+  const std::vector<cl::Program> objects = {cl_object};
+
+  cl_program = cl::linkProgram(objects,
+                               link_options.c_str(),
+                               nullptr,
+                               nullptr,
+                               &err);
+
+  if (err != CL_SUCCESS && from_cache)
+  {
+    // the cached object is not usable, compile it again from the sources
+    cache.invalidate(cl_device,
+                     sources,
+                     build_options,
+                     BinaryType::COMPILED_OBJECT);
+
+    helper_build_module(cl_context,
+                        cl_device,
+                        sources,
+                        build_options,
+                        false,
+                        cl_object,
+                        cl_program);
+    return;
+  }
+
+  if (err != CL_SUCCESS)
+  {
+    Logger::log()->critical("link error");
+    std::string build_log = cl_program()
+                                ? cl_program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(
+                                      cl_device)
+                                : "";
+    throw BuildError("Error linking, OpenCL linker says:", build_log, err);
+  }
+}
+
 KernelManager::KernelManager()
 {
   this->build_program();
 }
 
+KernelManager::KernelManager(const cl::Device &device) : fixed_device(device)
+{
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+  this->update_context();
+}
+
+KernelManager::~KernelManager()
+{
+  for (auto &module : this->modules)
+    if (module.pending_build.valid()) module.pending_build.wait();
+}
+
 void KernelManager::add_kernel(const std::string &kernel_sources,
                                bool               clear_sources)
 {
-  if (clear_sources)
-    this->full_sources = kernel_sources;
-  else
-    this->full_sources += kernel_sources;
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+    if (clear_sources) this->clear_sources();
+
+    Module module;
+    module.sources = kernel_sources;
+    this->modules.push_back(module);
+    this->is_program_linked = false;
 
+    if (this->lazy_build)
+    {
+      // kernel names are known from the sources until the module is built
+      for (auto &name : helper_scan_kernel_names(kernel_sources))
+        this->kernel_to_module[name] = this->modules.size() - 1;
+
+      Logger::log()->trace("module {} recorded, lazy build",
+                           this->modules.size() - 1);
+    }
+  }
+
+  // only the new module is built (unless the context or the build options
+  // have changed)
   this->build_program();
 }
 
+void KernelManager::add_kernel_header(const std::string &header_sources)
+{
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  this->header_sources += header_sources + "\n";
+
+  // modules are rebuilt with the new header at the next build_program call
+  for (auto &module : this->modules)
+    module.is_built = false;
+
+  this->is_program_linked = false;
+}
+
+void KernelManager::build_module(size_t module_index)
+{
+  std::string sources;
+  std::string header;
+  std::string options;
+  cl::Context context;
+  cl::Device  device;
+  size_t      current_generation;
+
+  // work on a copy of the module data so that the lock is not held during
+  // the build
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+    if (module_index >= this->modules.size()) return;
+    if (this->modules[module_index].is_built) return;
+
+    sources = this->modules[module_index].sources;
+    header = this->header_sources;
+    options = this->build_options;
+    context = this->cl_context;
+    device = this->cl_device;
+    current_generation = this->generation;
+  }
+
+  if (sources.length() == 0)
+  {
+    Logger::log()->trace("module {} building skipped, kernel sources are empty",
+                         module_index);
+    return;
+  }
+
+  Logger::log()->trace("building module {}", module_index);
+
+  // line numbers of the compiler log refer to the module sources
+  if (!header.empty()) sources = header + "#line 1\n" + sources;
+
+  cl::Program cl_object;
+  cl::Program cl_program;
+
+  helper_build_module(context,
+                      device,
+                      sources,
+                      options,
+                      true,
+                      cl_object,
+                      cl_program);
+
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  // the modules have been cleared or the device changed in the meantime
+  if (current_generation != this->generation ||
+      context() != this->cl_context() || options != this->build_options ||
+      header != this->header_sources)
+  {
+    Logger::log()->trace("module {} build discarded", module_index);
+    return;
+  }
+
+  Module &module = this->modules[module_index];
+
+  module.cl_object = cl_object;
+  module.cl_program = cl_program;
+
+  // kernel lookup table, names found by scanning the sources but unknown
+  // to the compiler are dropped
+  module.kernel_names = helper_split_kernel_names(
+      module.cl_program.getInfo<CL_PROGRAM_KERNEL_NAMES>());
+
+  for (auto it = this->kernel_to_module.begin();
+       it != this->kernel_to_module.end();)
+  {
+    if (it->second == module_index &&
+        std::find(module.kernel_names.begin(),
+                  module.kernel_names.end(),
+                  it->first) == module.kernel_names.end())
+      it = this->kernel_to_module.erase(it);
+    else
+      ++it;
+  }
+
+  for (auto &name : module.kernel_names)
+  {
+    auto it = this->kernel_to_module.find(name);
+
+    if (it != this->kernel_to_module.end() && it->second != module_index)
+      Logger::log()->warn("kernel [{}] already defined in module {}, "
+                          "overriden by module {}",
+                          name,
+                          it->second,
+                          module_index);
+
+    this->kernel_to_module[name] = module_index;
+  }
+
+  module.is_built = true;
+
+  Logger::log()->trace("available kernels: {}",
+                       module.cl_program.getInfo<CL_PROGRAM_KERNEL_NAMES>());
+}
+
 void KernelManager::build_program()
 {
   Logger::log()->trace("loading kernel sources");
 
-  if (this->full_sources.length() > 0)
+  size_t count = 0;
   {
-    cl::Device cl_device = clwrapper::DeviceManager::device();
-    this->cl_context = cl::Context({cl_device});
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+    if (this->modules.size() == 0)
+    {
+      Logger::log()->trace(
+          "program building skipped, kernel sources are empty");
+      return;
+    }
 
-    cl::Program::Sources sources;
+    this->update_context();
 
-    sources.push_back(
-        {this->full_sources.c_str(), this->full_sources.length()});
+    if (this->lazy_build) return;
 
-    Logger::log()->trace("building OpenCL kernels");
-    Logger::log()->trace("build options: {}", this->build_options);
+    count = this->modules.size();
+  }
 
-    this->cl_program = cl::Program(this->cl_context, sources);
-    int err = this->cl_program.build({cl_device}, this->build_options.c_str());
+  // modules already building in the background are waited for. Every
+  // module is built even if one fails, the first error is reported
+  std::exception_ptr error = nullptr;
 
-    if (err != 0)
+  for (size_t k = 0; k < count; k++)
+  {
+    try
     {
-      Logger::log()->critical("build error");
-      std::cout << " Error building, OpenCL compiler says:\n"
-                << "----------------------------------------------\n"
-                << this->cl_program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(
-                       cl_device)
-                << "----------------------------------------------\n";
-      clerror::throw_opencl_error(err);
+      this->wait_module_build(k);
+      this->build_module(k);
+    }
+    catch (...)
+    {
+      if (!error) error = std::current_exception();
+    }
+  }
+
+  if (error) std::rethrow_exception(error);
+}
+
+std::shared_future<void> KernelManager::build_program_async()
+{
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  std::vector<size_t>                   indices = {};
+  std::vector<std::shared_future<void>> others = {};
+
+  if (this->modules.size() > 0)
+  {
+    this->update_context();
+
+    for (size_t k = 0; k < this->modules.size(); k++)
+    {
+      Module &module = this->modules[k];
+
+      if (module.is_built) continue;
+
+      if (module.pending_build.valid())
+        others.push_back(module.pending_build);
+      else
+        indices.push_back(k);
+    }
+  }
+
+  Logger::log()->trace("building {} module(s) in the background",
+                       indices.size());
+
+  // every module is built even if one fails, the first error is reported
+  auto build_task = [this, indices, others]()
+  {
+    std::exception_ptr error = nullptr;
+
+    for (size_t k : indices)
+    {
+      try
+      {
+        this->build_module(k);
+      }
+      catch (...)
+      {
+        if (!error) error = std::current_exception();
+      }
+    }
+
+    for (auto &f : others)
+      f.wait();
+
+    if (error) std::rethrow_exception(error);
+  };
+
+  std::shared_future<void> future = std::async(std::launch::async, build_task)
+                                        .share();
+
+  for (size_t k : indices)
+    this->modules[k].pending_build = future;
+
+  return future;
+}
+
+void KernelManager::create_queue()
+{
+  int                         err = CL_SUCCESS;
+  cl_command_queue_properties properties = this->profiling
+                                               ? CL_QUEUE_PROFILING_ENABLE
+                                               : 0;
+
+  this->cl_queue = cl::CommandQueue(this->cl_context,
+                                    this->cl_device,
+                                    properties,
+                                    &err);
+  clerror::throw_opencl_error(err);
+}
+
+cl::Kernel KernelManager::checkout_kernel(const std::string &kernel_name)
+{
+  // builds the module or waits for it if needed
+  cl::Program program = this->get_program(kernel_name);
+
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  KernelPool &pool = this->kernel_pools[kernel_name];
+
+  // the module has been rebuilt, the pooled kernels are outdated
+  if (pool.cl_program() != program())
+  {
+    pool.cl_program = program;
+    pool.kernels.clear();
+  }
+
+  if (!pool.kernels.empty())
+  {
+    cl::Kernel kernel = pool.kernels.back();
+    pool.kernels.pop_back();
+    return kernel;
+  }
+
+  Logger::log()->trace("creating kernel object [{}]", kernel_name);
+
+  int        err = CL_SUCCESS;
+  cl::Kernel kernel = cl::Kernel(program, kernel_name.c_str(), &err);
+  clerror::throw_opencl_error(err);
+
+  return kernel;
+}
+
+void KernelManager::clear_sources()
+{
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  this->modules.clear();
+  this->header_sources = "";
+  this->kernel_to_module.clear();
+  this->kernel_pools.clear();
+  this->cl_program = cl::Program();
+  this->is_program_linked = false;
+  this->generation++;
+}
+
+cl::Context KernelManager::ensure_context()
+{
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  if (!this->cl_context()) this->update_context();
+  return this->cl_context;
+}
+
+std::vector<std::string> KernelManager::get_kernel_names() const
+{
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  std::vector<std::string> names = {};
+
+  for (auto &[name, _] : this->kernel_to_module)
+    names.push_back(name);
+
+  return names;
+}
+
+std::string KernelManager::get_kernel_sources(
+    const std::string &kernel_name) const
+{
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  auto it = this->kernel_to_module.find(kernel_name);
+  if (it != this->kernel_to_module.end())
+    return this->modules[it->second].sources;
+
+  // module not built yet
+  for (auto &module : this->modules)
+    for (auto &name : helper_scan_kernel_names(module.sources))
+      if (name == kernel_name) return module.sources;
+
+  return "";
+}
+
+cl::Program KernelManager::get_program()
+{
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  if (!this->is_program_linked)
+  {
+    std::vector<cl::Program> objects = {};
+
+    for (auto &module : this->modules)
+      if (module.is_built) objects.push_back(module.cl_object);
+
+    if (objects.empty()) return cl::Program();
+
+    int err = CL_SUCCESS;
+
+    this->cl_program = cl::linkProgram(
+        objects,
+        helper_extract_link_options(this->build_options).c_str(),
+        nullptr,
+        nullptr,
+        &err);
+    clerror::throw_opencl_error(err);
+
+    this->is_program_linked = true;
+  }
+
+  return this->cl_program;
+}
+
+cl::Program KernelManager::get_program(const std::string &kernel_name)
+{
+  size_t module_index = 0;
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+    auto it = this->kernel_to_module.find(kernel_name);
+
+    if (it == this->kernel_to_module.end())
+    {
+      Logger::log()->error("unknown kernel: [{}]", kernel_name);
+      throw std::invalid_argument("unknown kernel: " + kernel_name +
+                                  ", not found in any module");
     }
 
-    std::string kernel_names = this->cl_program
-                                   .getInfo<CL_PROGRAM_KERNEL_NAMES>();
-    Logger::log()->trace("available kernels: {}", kernel_names.c_str());
+    module_index = it->second;
+
+    if (this->modules[module_index].is_built)
+      return this->modules[module_index].cl_program;
   }
-  else
+
+  // the kernel is not ready, wait for its background build or build it now
+  this->wait_module_build(module_index);
+
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+    if (this->modules[module_index].is_built)
+      return this->modules[module_index].cl_program;
+
+    this->update_context();
+  }
+
+  Logger::log()->trace("kernel [{}] requested, building module {}",
+                       kernel_name,
+                       module_index);
+  this->build_module(module_index);
+
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  if (module_index >= this->modules.size() ||
+      !this->modules[module_index].is_built)
+    throw std::runtime_error("module holding the kernel " + kernel_name +
+                             " could not be built");
+
+  // the name has been found by scanning the sources, but the compiler
+  // does not know it (e.g. inside a disabled #if block)
+  const auto &names = this->modules[module_index].kernel_names;
+
+  if (std::find(names.begin(), names.end(), kernel_name) == names.end())
   {
-    Logger::log()->trace("program building skipped, kernel sources are empty");
+    Logger::log()->error("unknown kernel: [{}]", kernel_name);
+    throw std::invalid_argument("unknown kernel: " + kernel_name +
+                                ", not defined by module " +
+                                std::to_string(module_index));
   }
+
+  return this->modules[module_index].cl_program;
+}
+
+bool KernelManager::is_zero_copy() const
+{
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  switch (this->zero_copy_mode)
+  {
+  case ZeroCopyMode::ALWAYS: return true;
+  case ZeroCopyMode::NEVER: return false;
+  default: return this->host_unified_memory;
+  }
+}
+
+void KernelManager::release_kernel(const std::string &kernel_name,
+                                   const cl::Kernel  &kernel)
+{
+  if (!kernel()) return;
+
+  // raw query, to avoid retaining the program ('::' since cl_program is
+  // also a member name)
+  ::cl_program kernel_program = nullptr;
+  clGetKernelInfo(kernel(),
+                  CL_KERNEL_PROGRAM,
+                  sizeof(::cl_program),
+                  &kernel_program,
+                  nullptr);
+
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  auto it = this->kernel_pools.find(kernel_name);
+
+  if (it != this->kernel_pools.end() &&
+      it->second.cl_program() == kernel_program)
+    it->second.kernels.push_back(kernel);
 }
 
 void KernelManager::set_build_options(const std::string &new_build_options)
 {
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
   this->build_options = new_build_options;
+
+  // modules are rebuilt with the new options at the next build_program call
+  for (auto &module : this->modules)
+    module.is_built = false;
+
+  this->is_program_linked = false;
+}
+
+void KernelManager::set_profiling(bool new_state)
+{
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  if (new_state == this->profiling) return;
+
+  this->profiling = new_state;
+
+  if (this->cl_context()) this->create_queue();
+}
+
+void KernelManager::update_context()
+{
+  cl::Device device = this->fixed_device()
+                          ? this->fixed_device
+                          : clwrapper::DeviceManager::device();
+
+  if (this->cl_context() && this->cl_device() == device()) return;
+
+  Logger::log()->trace("creating OpenCL context");
+
+  this->cl_device = device;
+  this->cl_context = cl::Context({this->cl_device});
+  this->create_queue();
+
+  this->host_unified_memory = this->cl_device
+                                  .getInfo<CL_DEVICE_HOST_UNIFIED_MEMORY>();
+
+  // programs attached to the previous context can not be reused
+  for (auto &module : this->modules)
+    module.is_built = false;
+
+  this->is_program_linked = false;
+}
+
+void KernelManager::wait_module_build(size_t module_index)
+{
+  std::shared_future<void> pending;
+  {
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+    if (module_index >= this->modules.size()) return;
+    pending = this->modules[module_index].pending_build;
+  }
+
+  if (!pending.valid()) return;
+
+  std::exception_ptr error = nullptr;
+
+  try
+  {
+    pending.get();
+  }
+  catch (...)
+  {
+    error = std::current_exception();
+  }
+
+  std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+  if (module_index >= this->modules.size()) return;
+
+  // the error is reported once, a next request rebuilds the module
+  this->modules[module_index].pending_build = std::shared_future<void>();
+
+  if (error && !this->modules[module_index].is_built)
+    std::rethrow_exception(error);
+}
+
+void KernelManager::warm_up(const std::vector<std::string> &kernel_names)
+{
+  for (auto &name : kernel_names)
+    this->get_program(name);
 }
 
 } // namespace clwrapper
@@ -1,6 +1,8 @@
 /* Copyright (c) 2023 Otto Link. Distributed under the terms of the GNU General
  * Public License. The full license is in the file LICENSE, distributed with
  * this software. */
+#include <mutex>
+
 #include "cl_wrapper/logger.hpp"
 
 namespace clwrapper
@@ -11,12 +13,18 @@ std::shared_ptr<spdlog::logger> Logger::instance = nullptr;
 
 std::shared_ptr<spdlog::logger> &Logger::log()
 {
-  if (!instance)
-  {
-    instance = spdlog::stdout_color_mt("console_clwrapper");
-    instance->set_pattern("[clwrap] [%H:%M:%S] [%^---%L---%$] %v");
-    instance->set_level(spdlog::level::trace);
-  }
+  // first call may come from several threads at once
+  static std::once_flag flag;
+
+  std::call_once(flag,
+                 []()
+                 {
+                   instance = spdlog::stdout_color_mt("console_clwrapper");
+                   instance->set_pattern(
+                       "[clwrap] [%H:%M:%S] [%^---%L---%$] %v");
+                   instance->set_level(spdlog::level::trace);
+                 });
+
   return instance;
 }
 
@@ -0,0 +1,448 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <algorithm>
+
+#include "cl_wrapper/event.hpp"
+#include "cl_wrapper/kernel_manager.hpp"
+#include "cl_wrapper/logger.hpp"
+#include "cl_wrapper/multi_device.hpp"
+
+namespace clwrapper
+{
+
+// global size rounding, same as a single device Run
+static size_t helper_round_up(size_t n)
+{
+  const size_t bsize = 8;
+  return ((n + bsize - 1) / bsize) * bsize;
+}
+
+MultiDeviceManager::MultiDeviceManager()
+{
+  std::vector<cl::Platform> platforms;
+  cl::Platform::get(&platforms);
+
+  std::vector<cl::Device> usable_devices = {};
+
+  for (auto &platform : platforms)
+  {
+    std::vector<cl::Device> devices;
+    platform.getDevices(CL_DEVICE_TYPE_ALL, &devices);
+
+    for (auto &device : devices)
+      if (device.getInfo<CL_DEVICE_AVAILABLE>() &&
+          device.getInfo<CL_DEVICE_COMPILER_AVAILABLE>())
+        usable_devices.push_back(device);
+  }
+
+  this->set_devices(usable_devices);
+}
+
+cl::Kernel MultiDeviceManager::create_kernel(size_t             device_index,
+                                             const std::string &kernel_name)
+{
+  const std::string sources = KernelManager::get_instance().get_kernel_sources(
+      kernel_name);
+
+  if (sources.empty())
+  {
+    Logger::log()->error("unknown kernel: [{}]", kernel_name);
+    throw std::invalid_argument("unknown kernel: " + kernel_name +
+                                ", not found in any module");
+  }
+
+  // the program is built under the lock, only once per device
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  DeviceSlot &slot = this->slots.at(device_index);
+
+  auto it = slot.programs.find(sources);
+
+  if (it == slot.programs.end())
+  {
+    Logger::log()->trace("building kernel [{}] for device {}",
+                         kernel_name,
+                         slot.cl_device.getInfo<CL_DEVICE_NAME>());
+
+    cl::Program cl_object;
+    cl::Program cl_program;
+
+    helper_build_module(slot.cl_context,
+                        slot.cl_device,
+                        sources,
+                        KernelManager::get_instance().get_build_options(),
+                        true,
+                        cl_object,
+                        cl_program);
+
+    it = slot.programs.emplace(sources, cl_program).first;
+  }
+
+  int        err = CL_SUCCESS;
+  cl::Kernel kernel(it->second, kernel_name.c_str(), &err);
+  clerror::throw_opencl_error(err);
+
+  return kernel;
+}
+
+cl::Context MultiDeviceManager::get_context(size_t device_index) const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->slots.at(device_index).cl_context;
+}
+
+size_t MultiDeviceManager::get_device_count() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->slots.size();
+}
+
+std::vector<cl::Device> MultiDeviceManager::get_devices() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  std::vector<cl::Device> devices = {};
+
+  for (auto &slot : this->slots)
+    devices.push_back(slot.cl_device);
+
+  return devices;
+}
+
+cl::CommandQueue MultiDeviceManager::get_queue(size_t device_index) const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->slots.at(device_index).cl_queue;
+}
+
+std::vector<float> MultiDeviceManager::get_weights(
+    const std::string &kernel_name) const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  // compute units x clock estimate, brought to the scale of the measured
+  // throughputs for the devices not measured yet
+  std::vector<float> priors = {};
+  float              sum_measured = 0.f;
+  float              sum_priors_measured = 0.f;
+
+  for (auto &slot : this->slots)
+  {
+    const cl::Device &device = slot.cl_device;
+
+    priors.push_back(
+        (float)device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>() *
+        (float)device.getInfo<CL_DEVICE_MAX_CLOCK_FREQUENCY>());
+
+    auto it = slot.throughputs.find(kernel_name);
+
+    if (it != slot.throughputs.end())
+    {
+      sum_measured += it->second;
+      sum_priors_measured += priors.back();
+    }
+  }
+
+  float scale = sum_priors_measured > 0.f ? sum_measured / sum_priors_measured
+                                          : 1.f;
+
+  std::vector<float> weights = {};
+  float              sum = 0.f;
+
+  for (size_t k = 0; k < this->slots.size(); k++)
+  {
+    auto it = this->slots[k].throughputs.find(kernel_name);
+
+    float w = it != this->slots[k].throughputs.end() ? it->second
+                                                      : scale * priors[k];
+
+    weights.push_back(std::max(w, 0.f));
+    sum += weights.back();
+  }
+
+  for (auto &w : weights)
+    w = sum > 0.f ? w / sum : 1.f / (float)weights.size();
+
+  return weights;
+}
+
+void MultiDeviceManager::record_throughput(size_t             device_index,
+                                           const std::string &kernel_name,
+                                           float              throughput)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  auto &throughputs = this->slots.at(device_index).throughputs;
+  auto  it = throughputs.find(kernel_name);
+
+  if (it == throughputs.end())
+    throughputs[kernel_name] = throughput;
+  else
+    it->second = this->smoothing * throughput +
+                 (1.f - this->smoothing) * it->second;
+}
+
+void MultiDeviceManager::set_devices(const std::vector<cl::Device> &devices)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->slots.clear();
+
+  for (auto &device : devices)
+  {
+    int        err = CL_SUCCESS;
+    DeviceSlot slot;
+
+    slot.cl_device = device;
+    slot.cl_context = cl::Context({device}, nullptr, nullptr, nullptr, &err);
+
+    // device timings are used to balance the work
+    if (err == CL_SUCCESS)
+      slot.cl_queue = cl::CommandQueue(slot.cl_context,
+                                       device,
+                                       CL_QUEUE_PROFILING_ENABLE,
+                                       &err);
+
+    if (err != CL_SUCCESS)
+    {
+      Logger::log()->warn("multi-device: device {} skipped (error {})",
+                          device.getInfo<CL_DEVICE_NAME>(),
+                          err);
+      continue;
+    }
+
+    Logger::log()->trace("multi-device: using device {}",
+                         device.getInfo<CL_DEVICE_NAME>());
+
+    this->slots.push_back(slot);
+  }
+}
+
+void MultiDeviceManager::set_smoothing(float new_smoothing)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->smoothing = std::clamp(new_smoothing, 1e-3f, 1.f);
+}
+
+MultiDeviceRun::MultiDeviceRun(const std::string &kernel_name)
+    : kernel_name(kernel_name)
+{
+  MultiDeviceManager &manager = MultiDeviceManager::get_instance();
+
+  for (size_t k = 0; k < manager.get_device_count(); k++)
+    this->kernels.push_back(manager.create_kernel(k, kernel_name));
+}
+
+MultiDeviceRun::~MultiDeviceRun()
+{
+  for (auto &[id, buffer] : this->buffers)
+    for (auto &cl_buffer : buffer.cl_buffers)
+      BufferPool::get_instance().release(cl_buffer);
+}
+
+void MultiDeviceRun::bind_buffer_impl(const std::string &id,
+                                      void              *vector_ref,
+                                      size_t             size,
+                                      Direction          direction,
+                                      bool               is_partitioned)
+{
+  MultiDeviceManager &manager = MultiDeviceManager::get_instance();
+
+  PartitionedBuffer buffer;
+  buffer.vector_ref = vector_ref;
+  buffer.size = size;
+  buffer.direction = direction;
+  buffer.is_partitioned = is_partitioned;
+
+  cl_mem_flags flags = direction == Direction::IN ? CL_MEM_READ_ONLY
+                                                  : CL_MEM_WRITE_ONLY;
+
+  for (size_t k = 0; k < this->kernels.size(); k++)
+  {
+    cl::Buffer cl_buffer = BufferPool::get_instance().acquire_buffer(
+        manager.get_context(k),
+        flags,
+        size,
+        &err);
+    clerror::throw_opencl_error(err);
+
+    err = this->kernels[k].setArg(this->arg_count, cl_buffer);
+    clerror::throw_opencl_error(err);
+
+    buffer.cl_buffers.push_back(cl_buffer);
+  }
+
+  this->arg_count++;
+
+  auto it = this->buffers.find(id);
+  if (it != this->buffers.end())
+    for (auto &cl_buffer : it->second.cl_buffers)
+      BufferPool::get_instance().release(cl_buffer);
+
+  this->buffers[id] = buffer;
+}
+
+void MultiDeviceRun::execute(int total_elements, int halo)
+{
+  this->execute_partitioned(total_elements, 1, halo, false);
+}
+
+void MultiDeviceRun::execute(const std::vector<int> &global_range_2d, int halo)
+{
+  this->execute_partitioned(global_range_2d[1],
+                            global_range_2d[0],
+                            halo,
+                            true);
+}
+
+void MultiDeviceRun::execute_partitioned(int  units,
+                                         int  unit_width,
+                                         int  halo,
+                                         bool is_2d)
+{
+  MultiDeviceManager &manager = MultiDeviceManager::get_instance();
+  size_t              n_devices = this->kernels.size();
+
+  if (n_devices == 0 || units <= 0) return;
+
+  // partitioned buffers must be made of 'units' slices
+  for (auto &[id, buffer] : this->buffers)
+    if (buffer.is_partitioned && buffer.size % units != 0)
+    {
+      Logger::log()->error("multi-device: buffer [{}] of {} bytes can not be "
+                           "split in {} elements or rows",
+                           id,
+                           buffer.size,
+                           units);
+      throw std::invalid_argument("buffer " + id +
+                                  " size is not a multiple of the range");
+    }
+
+  // contiguous slices sized after the weights, every device gets at least
+  // one element or row so that its throughput gets measured
+  std::vector<float> weights = manager.get_weights(this->kernel_name);
+  std::vector<int>   bounds(n_devices + 1, 0);
+  float              cumul = 0.f;
+
+  for (size_t k = 0; k < n_devices; k++)
+  {
+    cumul += weights[k];
+    bounds[k + 1] = std::min(units, (int)(cumul * (float)units + 0.5f));
+
+    if (units >= (int)n_devices)
+      bounds[k + 1] = std::clamp(bounds[k + 1],
+                                 bounds[k] + 1,
+                                 units - (int)(n_devices - 1 - k));
+  }
+  bounds[n_devices] = units;
+
+  std::vector<cl::Event> kernel_events(n_devices);
+  std::vector<cl::Event> events = {};
+  bool                   is_first = true;
+
+  for (size_t k = 0; k < n_devices; k++)
+  {
+    int u0 = bounds[k];
+    int u1 = bounds[k + 1];
+
+    if (u1 <= u0) continue;
+
+    cl::CommandQueue queue = manager.get_queue(k);
+
+    int h0 = std::max(0, u0 - halo);
+    int h1 = std::min(units, u1 + halo);
+
+    // inputs, slice and halo only
+    for (auto &[id, buffer] : this->buffers)
+    {
+      if (buffer.direction != Direction::IN) continue;
+
+      size_t offset = 0;
+      size_t size = buffer.size;
+
+      if (buffer.is_partitioned)
+      {
+        size_t unit_bytes = buffer.size / units;
+        offset = (size_t)h0 * unit_bytes;
+        size = (size_t)(h1 - h0) * unit_bytes;
+      }
+
+      err = queue.enqueueWriteBuffer(
+          buffer.cl_buffers[k],
+          CL_FALSE,
+          offset,
+          size,
+          static_cast<char *>(buffer.vector_ref) + offset);
+      clerror::throw_opencl_error(err);
+    }
+
+    size_t      slice_size = helper_round_up(u1 - u0);
+    cl::NDRange offset = is_2d ? cl::NDRange(0, u0) : cl::NDRange(u0);
+    cl::NDRange global = is_2d ? cl::NDRange(helper_round_up(unit_width),
+                                             slice_size)
+                               : cl::NDRange(slice_size);
+
+    err = queue.enqueueNDRangeKernel(this->kernels[k],
+                                     offset,
+                                     global,
+                                     cl::NullRange,
+                                     nullptr,
+                                     &kernel_events[k]);
+    clerror::throw_opencl_error(err);
+
+    events.push_back(kernel_events[k]);
+
+    // outputs, merged back from the slices
+    for (auto &[id, buffer] : this->buffers)
+    {
+      if (buffer.direction != Direction::OUT) continue;
+
+      size_t offset = 0;
+      size_t size = buffer.size;
+
+      if (buffer.is_partitioned)
+      {
+        size_t unit_bytes = buffer.size / units;
+        offset = (size_t)u0 * unit_bytes;
+        size = (size_t)(u1 - u0) * unit_bytes;
+      }
+      else if (!is_first)
+        continue;
+
+      cl::Event cl_event;
+
+      err = queue.enqueueReadBuffer(
+          buffer.cl_buffers[k],
+          CL_FALSE,
+          offset,
+          size,
+          static_cast<char *>(buffer.vector_ref) + offset,
+          nullptr,
+          &cl_event);
+      clerror::throw_opencl_error(err);
+
+      events.push_back(cl_event);
+    }
+
+    queue.flush();
+    is_first = false;
+  }
+
+  err = cl::Event::waitForEvents(events);
+  clerror::throw_opencl_error(err);
+
+  // device execution times drive the next partitions
+  for (size_t k = 0; k < n_devices; k++)
+  {
+    if (!kernel_events[k]()) continue;
+
+    float dt = Event(kernel_events[k]).get_timing().get_execution_time();
+    float elements = (float)(bounds[k + 1] - bounds[k]) * (float)unit_width;
+
+    if (dt > 0.f)
+      manager.record_throughput(k, this->kernel_name, elements / dt);
+  }
+}
+
+} // namespace clwrapper
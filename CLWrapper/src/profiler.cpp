@@ -0,0 +1,202 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <algorithm>
+#include <set>
+
+#include "cl_wrapper/logger.hpp"
+#include "cl_wrapper/profiler.hpp"
+
+namespace clwrapper
+{
+
+KernelStats KernelProfiler::compute_stats(const Samples &s) const
+{
+  KernelStats stats = s.stats;
+
+  if (stats.count == 0) return stats;
+
+  stats.mean = stats.total / (float)stats.count;
+
+  std::vector<float> sorted(s.window.begin(), s.window.begin() + s.count);
+  std::sort(sorted.begin(), sorted.end());
+
+  auto percentile = [&sorted](float p)
+  {
+    size_t k = (size_t)(p * (float)(sorted.size() - 1) + 0.5f);
+    return sorted[std::min(k, sorted.size() - 1)];
+  };
+
+  stats.p50 = percentile(0.50f);
+  stats.p99 = percentile(0.99f);
+
+  return stats;
+}
+
+std::map<std::string, KernelStats> KernelProfiler::get_all_stats() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  std::map<std::string, KernelStats> all_stats = {};
+
+  for (auto &[name, s] : this->samples)
+    all_stats[name] = this->compute_stats(s);
+
+  return all_stats;
+}
+
+KernelStats KernelProfiler::get_stats(const std::string &kernel_name) const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  auto it = this->samples.find(kernel_name);
+  if (it == this->samples.end()) return KernelStats();
+
+  return this->compute_stats(it->second);
+}
+
+void KernelProfiler::flush()
+{
+  // launches recorded so far only, the ones added meanwhile by other
+  // threads are not waited for
+  std::vector<Event> events;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    events = this->pending_events;
+  }
+
+  // commands not flushed yet are submitted, once per queue
+  std::set<cl_command_queue> flushed_queues = {};
+
+  for (auto &e : events)
+  {
+    cl::CommandQueue queue = e.get_event().getInfo<CL_EVENT_COMMAND_QUEUE>();
+
+    if (queue() && flushed_queues.insert(queue()).second) queue.flush();
+  }
+
+  wait_for_events(events);
+
+  // the callbacks may be called slightly after the event completion
+  auto is_recorded = [this, &events]()
+  {
+    for (auto &e : events)
+      for (auto &p : this->pending_events)
+        if (p.get_event()() == e.get_event()()) return false;
+
+    return true;
+  };
+
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->cv_pending.wait(lock, is_recorded);
+}
+
+void KernelProfiler::log_stats() const
+{
+  for (auto &[name, s] : this->get_all_stats())
+    Logger::log()->info("{}: count: {}, min: {:.3f} ms, mean: {:.3f} ms, "
+                        "p50: {:.3f} ms, p99: {:.3f} ms, total: {:.3f} ms",
+                        name,
+                        s.count,
+                        s.min,
+                        s.mean,
+                        s.p50,
+                        s.p99,
+                        s.total);
+}
+
+void KernelProfiler::record(const std::string &kernel_name,
+                            const EventTiming &timing)
+{
+  // no profiling information
+  if (timing.end == 0) return;
+
+  float dt = timing.get_execution_time();
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  Samples &s = this->samples[kernel_name];
+
+  s.stats.min = s.stats.count == 0 ? dt : std::min(s.stats.min, dt);
+  s.stats.max = s.stats.count == 0 ? dt : std::max(s.stats.max, dt);
+  s.stats.total += dt;
+  s.stats.count++;
+
+  // ring buffer, the oldest sample is overwritten once full
+  if (s.window.size() != this->window_size) s.window.resize(this->window_size);
+
+  if (s.count < this->window_size)
+  {
+    s.window[(s.head + s.count) % this->window_size] = dt;
+    s.count++;
+  }
+  else
+  {
+    s.window[s.head] = dt;
+    s.head = (s.head + 1) % this->window_size;
+  }
+}
+
+void KernelProfiler::record_on_completion(const std::string &kernel_name,
+                                          const Event       &event)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->pending_events.push_back(event);
+  }
+
+  Event e = event;
+
+  e.then(
+      [this, kernel_name, event]()
+      {
+        this->record(kernel_name, event.get_timing());
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+
+        auto it = std::find_if(this->pending_events.begin(),
+                               this->pending_events.end(),
+                               [&event](const Event &p) {
+                                 return p.get_event()() ==
+                                        event.get_event()();
+                               });
+
+        if (it != this->pending_events.end()) this->pending_events.erase(it);
+
+        this->cv_pending.notify_all();
+      });
+}
+
+void KernelProfiler::reset()
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  // launches still pending are recorded afterwards
+  this->samples.clear();
+}
+
+void KernelProfiler::set_window_size(size_t new_window_size)
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->window_size = std::max((size_t)1, new_window_size);
+
+  // the newest samples are kept, in chronological order
+  for (auto &[name, s] : this->samples)
+  {
+    size_t             kept_count = std::min(s.count, this->window_size);
+    std::vector<float> window(this->window_size);
+
+    for (size_t k = 0; k < kept_count; k++)
+    {
+      size_t age = kept_count - 1 - k; // 0 for the newest sample
+      window[k] = s.window[(s.head + s.count - 1 - age) % s.window.size()];
+    }
+
+    s.window = window;
+    s.head = 0;
+    s.count = kept_count;
+  }
+}
+
+} // namespace clwrapper
@@ -2,130 +2,495 @@
  * Public License. The full license is in the file LICENSE, distributed with
  * this software. */
 #include <chrono>
+#include <stdexcept>
 
 #include "cl_error_lookup.hpp"
 
+#include "cl_wrapper/autotuner.hpp"
 #include "cl_wrapper/device_manager.hpp"
 #include "cl_wrapper/kernel_manager.hpp"
 #include "cl_wrapper/logger.hpp"
+#include "cl_wrapper/profiler.hpp"
 #include "cl_wrapper/run.hpp"
 
 namespace clwrapper
 {
 
-Run::Run(const std::string &kernel_name) : kernel_name(kernel_name)
+Run::Run(const std::string &kernel_name)
+    : kernel_name(kernel_name), p_runtime(nullptr)
 {
-  Logger::log()->trace("Run::Run [{}]", this->kernel_name.c_str());
+  // the OpenCL runtime is not touched, it may not be available
+  if (HostBackend::get_instance().is_used(kernel_name))
+  {
+    this->is_host = true;
+    Logger::log()->trace("run [{}] on the host backend", kernel_name);
+    return;
+  }
 
-  this->queue = cl::CommandQueue(KernelManager::context(),
-                                 DeviceManager::device());
+  this->setup_runtime(KernelManager::get_instance());
+}
 
-  this->cl_kernel = cl::Kernel(KernelManager::program(),
-                               this->kernel_name.c_str(),
-                               &err);
-  clerror::throw_opencl_error(err);
+Run::Run(const std::string &kernel_name, KernelManager &runtime)
+    : kernel_name(kernel_name), p_runtime(nullptr)
+{
+  this->setup_runtime(runtime);
+}
+
+Run::Run(Run &&other)
+{
+  *this = std::move(other);
+}
+
+Run &Run::operator=(Run &&other)
+{
+  if (this == &other) return *this;
+
+  this->release();
+
+  this->kernel_name = std::move(other.kernel_name);
+  this->p_runtime = other.p_runtime;
+  this->queue = std::move(other.queue);
+  this->cl_kernel = std::move(other.cl_kernel);
+  this->arg_count = other.arg_count;
+  this->buffers = std::move(other.buffers);
+  this->images = std::move(other.images);
+  this->buffer_indices = std::move(other.buffer_indices);
+  this->image_indices = std::move(other.image_indices);
+  this->resources = std::move(other.resources);
+  this->is_pending = other.is_pending;
+  this->is_profiling = other.is_profiling;
+  this->is_zero_copy = other.is_zero_copy;
+  this->is_pinned = other.is_pinned;
+  this->is_host = other.is_host;
+  this->host_args = std::move(other.host_args);
+  this->tuned_global_size = std::move(other.tuned_global_size);
+  this->tuned_local_size = std::move(other.tuned_local_size);
+  this->tuned_generation = other.tuned_generation;
+  this->bytes_saved = other.bytes_saved;
+
+  // nothing left to wait for or to give back by the moved-from instance
+  other.p_runtime = nullptr;
+  other.queue = cl::CommandQueue();
+  other.cl_kernel = cl::Kernel();
+  other.arg_count = 0;
+  other.buffers.clear();
+  other.images.clear();
+  other.buffer_indices.clear();
+  other.image_indices.clear();
+  other.resources.clear();
+  other.is_pending = false;
+  other.host_args = HostArgs();
+
+  return *this;
 }
 
 Run::~Run()
 {
-  this->queue.finish();
+  this->release();
 }
 
-void Run::bind_imagef(const std::string  &id,
-                      std::vector<float> &vector,
-                      int                 width,
-                      int                 height,
-                      Direction           direction)
+BufferHandle Run::bind_buffer_impl(const std::string &id,
+                                   void              *vector_ref,
+                                   size_t             size,
+                                   cl_mem_flags       flags)
 {
-  Image2D img;
+  Buffer buffer;
 
-  img.vector_ref = static_cast<void *>(vector.data());
-  img.width = width;
-  img.height = height;
+  buffer.id = id;
+  buffer.vector_ref = vector_ref;
+  buffer.size = size;
+  buffer.flags = flags;
+  buffer.arg_index = this->arg_count++;
 
-  if (direction == Direction::IN)
-    img.cl_image = cl::Image2D(KernelManager::context(),
-                               CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
-                               cl::ImageFormat(CL_R, CL_FLOAT),
-                               width,
-                               height,
-                               0,
-                               (void *)img.vector_ref,
-                               &err);
+  this->create_buffer(buffer);
+
+  this->set_buffer_arg(buffer);
+
+  // rebinding an id keeps its handle and gives the previous buffer back to
+  // the pool
+  BufferHandle handle = this->get_buffer_handle(id);
+
+  if (handle.index != INVALID_HANDLE)
+  {
+    this->release_buffer(this->buffers[handle.index]);
+    this->buffers[handle.index] = buffer;
+  }
   else
-    img.cl_image = cl::Image2D(KernelManager::context(),
-                               CL_MEM_WRITE_ONLY,
-                               cl::ImageFormat(CL_R, CL_FLOAT),
-                               width,
-                               height,
-                               0,
-                               nullptr,
-                               &err);
+  {
+    handle.index = this->buffers.size();
+    this->buffers.push_back(buffer);
+    this->buffer_indices[id] = handle.index;
+  }
+
+  return handle;
+}
+
+void Run::check_context(const std::string &id,
+                        const cl::Context &context) const
+{
+  // OpenCL objects cannot be used by host kernels
+  if (this->is_host)
+  {
+    Logger::log()->error("run [{}]: [{}] cannot be bound on the host backend",
+                         this->kernel_name,
+                         id);
+    throw std::invalid_argument("run " + this->kernel_name + ": " + id +
+                                " cannot be bound on the host backend");
+  }
 
+  if (!this->p_runtime || context() == this->p_runtime->get_context()())
+    return;
+
+  Logger::log()->error("run [{}]: [{}] belongs to another runtime",
+                       this->kernel_name,
+                       id);
+  throw std::invalid_argument("run " + this->kernel_name + ": " + id +
+                              " belongs to another runtime");
+}
+
+void Run::create_buffer(Buffer &buffer)
+{
+  cl_mem_flags flags = buffer.flags;
+
+  buffer.mode = BufferMode::COPY;
+
+  if (this->is_host)
+  {
+    buffer.mode = BufferMode::HOST;
+    buffer.cl_buffer = cl::Buffer();
+    return;
+  }
+
+  // SVM allocations are used in place, whatever the zero-copy mode
+  SVMAllocation allocation;
+
+  if (buffer.size > 0 && find_svm_allocation(buffer.vector_ref, allocation) &&
+      allocation.context() == this->p_runtime->get_context()() &&
+      allocation.size >= buffer.size)
+  {
+    buffer.mode = allocation.is_fine_grain ? BufferMode::SVM_FINE
+                                           : BufferMode::SVM_COARSE;
+    buffer.cl_buffer = cl::Buffer();
+    return;
+  }
+
+  // unaligned host data can not be used in place, they are copied
+  if (this->is_zero_copy && buffer.size > 0)
+  {
+    if (is_host_ptr_aligned(buffer.vector_ref))
+      buffer.mode = BufferMode::ZERO_COPY;
+    else if (this->is_pinned)
+      buffer.mode = BufferMode::PINNED;
+  }
+
+  switch (buffer.mode)
+  {
+  case BufferMode::ZERO_COPY:
+    // host data used in place, not pooled
+    buffer.cl_buffer = cl::Buffer(this->p_runtime->get_context(),
+                                  flags | CL_MEM_USE_HOST_PTR,
+                                  buffer.size,
+                                  buffer.vector_ref,
+                                  &err);
+    break;
+  case BufferMode::PINNED:
+    Logger::log()->trace("buffer [{}] not aligned for zero-copy, using a "
+                         "host accessible buffer",
+                         buffer.id);
+    flags |= CL_MEM_ALLOC_HOST_PTR;
+    [[fallthrough]];
+  default:
+    buffer.cl_buffer = BufferPool::get_instance().acquire_buffer(
+        this->p_runtime->get_context(),
+        flags,
+        buffer.size,
+        &err);
+  }
   clerror::throw_opencl_error(err);
+}
+
+void Run::bind_imagef(const std::string &id, DeviceImage &image)
+{
+  this->check_context(id, image.get_image().getInfo<CL_MEM_CONTEXT>());
 
-  err = this->cl_kernel.setArg(this->arg_count++, img.cl_image);
+  err = this->cl_kernel.setArg(this->arg_count++, image.get_image());
   clerror::throw_opencl_error(err);
 
-  this->images_2d[id] = img;
+  this->resources[id] = &image;
+}
+
+ImageHandle Run::bind_image_impl(const std::string        &id,
+                                 void                     *vector_ref,
+                                 size_t                    size,
+                                 size_t                    value_size,
+                                 const std::array<int, 3> &dims,
+                                 cl_mem_object_type        type,
+                                 const cl::ImageFormat    &format,
+                                 Direction                 direction)
+{
+  // host layout
+  size_t channels = channel_count(format.image_channel_order);
+
+  if (channels == 0 ||
+      channel_type_size(format.image_channel_data_type) != value_size)
+  {
+    Logger::log()->error("image [{}]: host value type does not match the "
+                         "image format",
+                         id);
+    throw std::invalid_argument("image format does not match the host type");
+  }
+
+  if (size < (size_t)dims[0] * dims[1] * dims[2] * channels * value_size)
+  {
+    Logger::log()->error("image [{}]: host vector smaller than the image", id);
+    throw std::invalid_argument("host vector smaller than the image");
+  }
+
+  Image img;
+
+  img.id = id;
+  img.vector_ref = vector_ref;
+  img.width = dims[0];
+  img.height = dims[1];
+  img.depth = dims[2];
+  img.type = type;
+  img.format = format;
+  img.direction = direction;
+  img.arg_index = this->arg_count++;
+
+  if (this->is_host)
+  {
+    // pixels read and written in place by the host kernels
+    this->host_args.set_pointer(img.arg_index, vector_ref, size);
+  }
+  else
+  {
+    this->create_image(img);
+
+    err = this->cl_kernel.setArg(img.arg_index, img.cl_image);
+    clerror::throw_opencl_error(err);
+  }
+
+  ImageHandle handle = this->get_image_handle(id);
+
+  if (handle.index != INVALID_HANDLE)
+  {
+    this->release_image(this->images[handle.index]);
+    this->images[handle.index] = img;
+  }
+  else
+  {
+    handle.index = this->images.size();
+    this->images.push_back(img);
+    this->image_indices[id] = handle.index;
+  }
+
+  // input data are copied at binding
+  if (direction == Direction::IN) this->write_image(handle);
+
+  return handle;
 }
 
-void Run::bind_imagef(const std::string  &id,
-                      std::vector<float> &vector,
-                      int                 width,
-                      int                 height,
-                      bool                is_out)
+ImageHandle Run::bind_imagef(const std::string  &id,
+                             std::vector<float> &vector,
+                             int                 width,
+                             int                 height,
+                             Direction           direction)
+{
+  return this->bind_image(id, vector, width, height, direction);
+}
+
+ImageHandle Run::bind_imagef(const std::string  &id,
+                             std::vector<float> &vector,
+                             int                 width,
+                             int                 height,
+                             bool                is_out)
 {
   Direction direction = is_out ? Direction::OUT : Direction::IN;
-  bind_imagef(id, vector, width, height, direction);
+  return bind_imagef(id, vector, width, height, direction);
 }
 
-void Run::bind_imagef(const std::string        &id,
-                      const std::vector<float> &vector,
-                      int                       width,
-                      int                       height,
-                      bool                      is_out)
+ImageHandle Run::bind_imagef(const std::string        &id,
+                             const std::vector<float> &vector,
+                             int                       width,
+                             int                       height,
+                             bool                      is_out)
 {
-  bind_imagef(id,
-              const_cast<std::vector<float> &>(vector),
-              width,
-              height,
-              is_out);
+  return bind_imagef(id,
+                     const_cast<std::vector<float> &>(vector),
+                     width,
+                     height,
+                     is_out);
 }
 
-void Run::execute(int total_elements, float *p_elapsed_time)
+void Run::create_image(Image &img)
 {
-  // Logger::log()->trace("executing... [%s]", this->kernel_name.c_str());
+  cl::Context  context = this->p_runtime->get_context();
+  cl_mem_flags flags = img.direction == Direction::IN ? CL_MEM_READ_ONLY
+                                                      : CL_MEM_WRITE_ONLY;
 
-  this->queue.flush();
+  if (!is_image_format_supported(context, flags, img.type, img.format))
+  {
+    Logger::log()->error("image [{}]: format (order: {:#x}, type: {:#x}) not "
+                         "supported by the device",
+                         img.id,
+                         img.format.image_channel_order,
+                         img.format.image_channel_data_type);
+    clerror::throw_opencl_error(CL_IMAGE_FORMAT_NOT_SUPPORTED);
+  }
 
-  // ensure gloabl size is rounded up to the nearest multiple of a power of 2 to
-  // avoid weird global size with no divisor
-  int bsize = 8;
-  int gsize = ((total_elements + bsize - 1) / bsize) * bsize;
+  // only 2D images are pooled
+  switch (img.type)
+  {
+  case CL_MEM_OBJECT_IMAGE3D:
+    img.cl_image = cl::Image3D(context,
+                               flags,
+                               img.format,
+                               img.width,
+                               img.height,
+                               img.depth,
+                               0,
+                               0,
+                               nullptr,
+                               &err);
+    break;
+  case CL_MEM_OBJECT_IMAGE2D_ARRAY:
+    img.cl_image = cl::Image2DArray(context,
+                                    flags,
+                                    img.format,
+                                    img.depth,
+                                    img.width,
+                                    img.height,
+                                    0,
+                                    0,
+                                    nullptr,
+                                    &err);
+    break;
+  default:
+    img.cl_image = BufferPool::get_instance().acquire_image2d(context,
+                                                              flags,
+                                                              img.format,
+                                                              img.width,
+                                                              img.height,
+                                                              &err);
+  }
+  clerror::throw_opencl_error(err);
+}
+
+Event Run::enqueue_kernel(const std::vector<size_t> &global_size,
+                          const std::vector<Event>  &wait_list,
+                          bool                       is_blocking)
+{
+  if (this->is_host)
+  {
+    for (auto &e : wait_list)
+      e.wait();
+
+    HostBackend::get_instance().execute(this->kernel_name,
+                                        global_size,
+                                        this->host_args);
+    return Event();
+  }
+
+  std::vector<cl::Event> cl_wait_list = to_cl_events(wait_list);
+  cl::Event              cl_event;
+
+  // modified device-resident data, uploaded without blocking
+  for (auto &[id, resource] : this->resources)
+  {
+    cl::Event upload = resource->sync_device(this->queue);
+    if (upload()) cl_wait_list.push_back(upload);
+  }
 
-  const cl::NDRange global_work_size(gsize);
+  for (auto &e : this->unmap_buffers())
+    cl_wait_list.push_back(e);
+
+  for (auto &e : this->upload_dirty_ranges())
+    cl_wait_list.push_back(e);
+
+  // tuned local size if any, looked up once per global size, the global
+  // size is padded accordingly
+  Autotuner &tuner = Autotuner::get_instance();
+
+  if (!tuner.is_enabled())
+  {
+    this->tuned_local_size.clear();
+  }
+  else if (this->tuned_generation != tuner.get_generation() ||
+           this->tuned_global_size != global_size)
+  {
+    this->tuned_local_size = tuner.get_local_size(this->kernel_name,
+                                                  this->cl_kernel,
+                                                  this->queue,
+                                                  global_size,
+                                                  cl_wait_list);
+    this->tuned_global_size = global_size;
+    this->tuned_generation = tuner.get_generation();
+  }
+
+  const std::vector<size_t> &local_size = this->tuned_local_size;
+  std::vector<size_t> padded_size = Autotuner::pad_global_size(global_size,
+                                                               local_size);
 
   err = this->queue.enqueueNDRangeKernel(this->cl_kernel,
                                          cl::NullRange,
-                                         global_work_size,
-                                         cl::NullRange);
+                                         to_ndrange(padded_size),
+                                         to_ndrange(local_size),
+                                         cl_wait_list.empty() ? nullptr
+                                                              : &cl_wait_list,
+                                         &cl_event);
   clerror::throw_opencl_error(err);
 
+  for (auto &[id, resource] : this->resources)
+    resource->mark_device_modified(cl_event);
+
+  // waited for before the SVM allocations are freed
+  for (auto &buffer : this->buffers)
+    if (is_svm_mode(buffer.mode)) svm_set_last_use(buffer.vector_ref, cl_event);
+
+  this->is_pending = true;
+
+  Event event(cl_event);
+
+  // device timings are recorded once the kernel is complete, by the caller
+  // for blocking launches
+  if (this->is_profiling && !is_blocking)
+    KernelProfiler::get_instance().record_on_completion(this->kernel_name,
+                                                        event);
+
+  return event;
+}
+
+void Run::execute(int total_elements, float *p_elapsed_time)
+{
+  // Logger::log()->trace("executing... [%s]", this->kernel_name.c_str());
+
+  if (this->is_host)
+  {
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    Event event = this->execute_async(total_elements);
+
+    if (p_elapsed_time) *p_elapsed_time = this->get_elapsed_time(event, t0);
+    return;
+  }
+
+  this->queue.flush();
+
   auto t0 = std::chrono::high_resolution_clock::now();
 
+  Event event = this->enqueue_kernel({(size_t)total_elements}, {}, true);
+
   err = this->queue.finish();
   clerror::throw_opencl_error(err);
 
-  // compute elapsed time
-  if (p_elapsed_time)
-  {
-    auto t1 = std::chrono::high_resolution_clock::now();
+  this->is_pending = false;
 
-    *p_elapsed_time =
-        std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() *
-        1e-6f;
-  }
+  if (this->is_profiling)
+    KernelProfiler::get_instance().record(this->kernel_name,
+                                          event.get_timing());
+
+  if (p_elapsed_time) *p_elapsed_time = this->get_elapsed_time(event, t0);
 }
 
 void Run::execute(const std::vector<int> &global_range_2d,
@@ -133,116 +498,821 @@ void Run::execute(const std::vector<int> &global_range_2d,
 {
   // Logger::log()->trace("executing... [%s]", this->kernel_name.c_str());
 
-  this->queue.flush();
+  if (this->is_host)
+  {
+    auto t0 = std::chrono::high_resolution_clock::now();
 
-  int bsize = 8;
-  int gsize_x = ((global_range_2d[0] + bsize - 1) / bsize) * bsize;
-  int gsize_y = ((global_range_2d[1] + bsize - 1) / bsize) * bsize;
+    Event event = this->execute_async(global_range_2d);
 
-  const cl::NDRange global_work_size(gsize_x, gsize_y);
+    if (p_elapsed_time) *p_elapsed_time = this->get_elapsed_time(event, t0);
+    return;
+  }
 
-  err = this->queue.enqueueNDRangeKernel(this->cl_kernel,
-                                         cl::NullRange,
-                                         global_work_size,
-                                         cl::NullRange);
-  clerror::throw_opencl_error(err);
+  this->queue.flush();
 
   auto t0 = std::chrono::high_resolution_clock::now();
 
+  // only waited for if the elapsed time is requested
+  bool  is_blocking = p_elapsed_time != nullptr;
+  Event event = this->enqueue_kernel(
+      {(size_t)global_range_2d[0], (size_t)global_range_2d[1]},
+      {},
+      is_blocking);
+
   err = this->queue.flush();
   clerror::throw_opencl_error(err);
 
-  // compute elapsed time
-  if (p_elapsed_time)
+  // the elapsed time is only available once the kernel is complete
+  if (is_blocking)
   {
-    auto t1 = std::chrono::high_resolution_clock::now();
+    event.wait();
 
-    *p_elapsed_time =
-        std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() *
-        1e-6f;
+    if (this->is_profiling)
+      KernelProfiler::get_instance().record(this->kernel_name,
+                                            event.get_timing());
+
+    *p_elapsed_time = this->get_elapsed_time(event, t0);
   }
 }
 
+Event Run::execute_async(int                       total_elements,
+                         const std::vector<Event> &wait_list)
+{
+  return this->enqueue_kernel({(size_t)total_elements}, wait_list);
+}
+
+Event Run::execute_async(const std::vector<int>   &global_range_2d,
+                         const std::vector<Event> &wait_list)
+{
+  return this->enqueue_kernel(
+      {(size_t)global_range_2d[0], (size_t)global_range_2d[1]},
+      wait_list);
+}
+
+BufferHandle Run::find_buffer(const std::string &id) const
+{
+  BufferHandle handle = this->get_buffer_handle(id);
+
+  if (handle.index == INVALID_HANDLE)
+    Logger::log()->error("unknown buffer id: [{}]", id.c_str());
+
+  return handle;
+}
+
+ImageHandle Run::find_image(const std::string &id) const
+{
+  ImageHandle handle = this->get_image_handle(id);
+
+  if (handle.index == INVALID_HANDLE)
+    Logger::log()->error("unknown image id: [{}]", id.c_str());
+
+  return handle;
+}
+
+Buffer *Run::get_buffer(BufferHandle handle)
+{
+  if (handle.index < this->buffers.size()) return &this->buffers[handle.index];
+
+  if (handle.index != INVALID_HANDLE)
+    Logger::log()->error("invalid buffer handle: {}", handle.index);
+
+  return nullptr;
+}
+
+BufferHandle Run::get_buffer_handle(const std::string &id) const
+{
+  auto it = this->buffer_indices.find(id);
+  return it != this->buffer_indices.end() ? BufferHandle{it->second}
+                                          : BufferHandle{};
+}
+
+BufferMode Run::get_buffer_mode(const std::string &id) const
+{
+  BufferHandle handle = this->get_buffer_handle(id);
+
+  return handle.index < this->buffers.size() ? this->buffers[handle.index].mode
+                                             : BufferMode::COPY;
+}
+
+float Run::get_elapsed_time(
+    const Event                                          &event,
+    const std::chrono::high_resolution_clock::time_point &t0) const
+{
+  if (this->is_profiling) return event.get_timing().get_execution_time();
+
+  auto t1 = std::chrono::high_resolution_clock::now();
+
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0)
+             .count() *
+         1e-6f;
+}
+
+Image *Run::get_image(ImageHandle handle)
+{
+  if (handle.index < this->images.size()) return &this->images[handle.index];
+
+  if (handle.index != INVALID_HANDLE)
+    Logger::log()->error("invalid image handle: {}", handle.index);
+
+  return nullptr;
+}
+
+ImageHandle Run::get_image_handle(const std::string &id) const
+{
+  auto it = this->image_indices.find(id);
+  return it != this->image_indices.end() ? ImageHandle{it->second}
+                                         : ImageHandle{};
+}
+
+void Run::mark_dirty(const std::string &id, size_t offset, size_t size)
+{
+  this->mark_dirty(this->find_buffer(id), offset, size);
+}
+
+void Run::mark_dirty(BufferHandle handle, size_t offset, size_t size)
+{
+  Buffer *p_buffer = this->get_buffer(handle);
+  if (!p_buffer) return;
+
+  // written so that offset + size can not overflow
+  if (size > p_buffer->size || offset > p_buffer->size - size)
+  {
+    Logger::log()->error("buffer [{}]: dirty range of {} bytes at offset {} "
+                         "out of bounds",
+                         p_buffer->id,
+                         size,
+                         offset);
+    return;
+  }
+
+  p_buffer->dirty_ranges.add(offset, size);
+}
+
 void Run::read_buffer(const std::string &id)
 {
-  if (this->buffers.find(id) != this->buffers.end())
+  this->read_buffer_async(id).wait();
+}
+
+void Run::read_buffer(BufferHandle handle)
+{
+  this->read_buffer_async(handle).wait();
+}
+
+Event Run::read_buffer_async(const std::string        &id,
+                             const std::vector<Event> &wait_list)
+{
+  return this->read_buffer_async(this->find_buffer(id), wait_list);
+}
+
+Event Run::read_buffer_async(BufferHandle              handle,
+                             const std::vector<Event> &wait_list)
+{
+  Buffer *p_buffer = this->get_buffer(handle);
+  if (!p_buffer) return Event();
+
+  return this->read_buffer_async(handle, 0, p_buffer->size, wait_list);
+}
+
+void Run::read_buffer(const std::string &id, size_t offset, size_t size)
+{
+  this->read_buffer_async(id, offset, size).wait();
+}
+
+void Run::read_buffer(BufferHandle handle, size_t offset, size_t size)
+{
+  this->read_buffer_async(handle, offset, size).wait();
+}
+
+Event Run::read_buffer_async(const std::string        &id,
+                             size_t                    offset,
+                             size_t                    size,
+                             const std::vector<Event> &wait_list)
+{
+  return this->read_buffer_async(this->find_buffer(id),
+                                 offset,
+                                 size,
+                                 wait_list);
+}
+
+Event Run::read_buffer_async(BufferHandle              handle,
+                             size_t                    offset,
+                             size_t                    size,
+                             const std::vector<Event> &wait_list)
+{
+  Buffer *p_buffer = this->get_buffer(handle);
+  if (!p_buffer) return Event();
+
+  Buffer &buffer = *p_buffer;
+
+  // written so that offset + size can not overflow
+  if (size > buffer.size || offset > buffer.size - size)
+  {
+    Logger::log()->error("buffer [{}]: range of {} bytes at offset {} out of "
+                         "bounds",
+                         buffer.id,
+                         size,
+                         offset);
+    return Event();
+  }
+
+  // host data used in place by the host kernels
+  if (buffer.mode == BufferMode::HOST) return Event();
+
+  std::vector<cl::Event> cl_wait_list = to_cl_events(wait_list);
+  cl::Event              cl_event;
+
+  const std::vector<cl::Event> *p_wait_list = cl_wait_list.empty()
+                                                  ? nullptr
+                                                  : &cl_wait_list;
+
+  if (buffer.mode == BufferMode::SVM_COARSE)
   {
-    err = this->queue.enqueueReadBuffer(buffers[id].cl_buffer,
-                                        CL_TRUE,
-                                        0,
-                                        buffers[id].size,
-                                        buffers[id].vector_ref);
+    // as for zero-copy buffers, the allocation is owned by the host until
+    // the next kernel launch (empty event if already mapped)
+    cl_event = svm_map(this->queue,
+                       buffer.vector_ref,
+                       CL_MAP_READ | CL_MAP_WRITE,
+                       p_wait_list);
+    if (!cl_event()) return Event();
+  }
+  else if (buffer.mode == BufferMode::SVM_FINE)
+  {
+    // shared memory, the previous commands only need to be complete
+    err = this->queue.enqueueMarkerWithWaitList(p_wait_list, &cl_event);
     clerror::throw_opencl_error(err);
   }
+  else if (buffer.mode == BufferMode::ZERO_COPY)
+  {
+    // already owned by the host
+    if (buffer.is_mapped) return Event();
+
+    // the mapped region is the host data itself, nothing is copied on
+    // devices sharing the host memory. The whole buffer is mapped whatever
+    // the range and stays mapped until the next kernel launch
+    this->queue.enqueueMapBuffer(buffer.cl_buffer,
+                                 CL_FALSE,
+                                 CL_MAP_READ | CL_MAP_WRITE,
+                                 0,
+                                 buffer.size,
+                                 p_wait_list,
+                                 &cl_event,
+                                 &err);
+    clerror::throw_opencl_error(err);
+
+    buffer.is_mapped = true;
+  }
   else
   {
-    Logger::log()->error("unknown buffer id: [{}]", id.c_str());
+    // PINNED buffers are copied as well, the driver transfers directly
+    // from the host accessible memory
+    err = this->queue.enqueueReadBuffer(
+        buffer.cl_buffer,
+        CL_FALSE,
+        offset,
+        size,
+        static_cast<char *>(buffer.vector_ref) + offset,
+        p_wait_list,
+        &cl_event);
+    clerror::throw_opencl_error(err);
   }
+
+  this->is_pending = true;
+  this->queue.flush();
+
+  return Event(cl_event);
+}
+
+void Run::read_image(const std::string &id)
+{
+  this->read_image_async(id).wait();
+}
+
+void Run::read_image(ImageHandle handle)
+{
+  this->read_image_async(handle).wait();
+}
+
+Event Run::read_image_async(const std::string        &id,
+                            const std::vector<Event> &wait_list)
+{
+  return this->read_image_async(this->find_image(id), wait_list);
+}
+
+Event Run::read_image_async(ImageHandle               handle,
+                            const std::vector<Event> &wait_list)
+{
+  Image *p_img = this->get_image(handle);
+  if (!p_img || this->is_host) return Event();
+
+  Image &img = *p_img;
+
+  cl::array<size_t, 3> origin = {0, 0, 0};
+  cl::array<size_t, 3> region = {(size_t)img.width,
+                                 (size_t)img.height,
+                                 (size_t)img.depth};
+
+  std::vector<cl::Event> cl_wait_list = to_cl_events(wait_list);
+  cl::Event              cl_event;
+
+  err = this->queue.enqueueReadImage(img.cl_image,
+                                     CL_FALSE,
+                                     origin,
+                                     region,
+                                     0,
+                                     0,
+                                     img.vector_ref,
+                                     cl_wait_list.empty() ? nullptr
+                                                          : &cl_wait_list,
+                                     &cl_event);
+  clerror::throw_opencl_error(err);
+
+  this->is_pending = true;
+  this->queue.flush();
+
+  return Event(cl_event);
 }
 
 void Run::read_imagef(const std::string &id)
 {
-  if (this->images_2d.find(id) != this->images_2d.end())
+  this->read_image(id);
+}
+
+Event Run::read_imagef_async(const std::string        &id,
+                             const std::vector<Event> &wait_list)
+{
+  return this->read_image_async(id, wait_list);
+}
+
+void Run::rebind_buffer_impl(BufferHandle handle,
+                             void        *vector_ref,
+                             size_t       size)
+{
+  Buffer *p_buffer = this->get_buffer(handle);
+  if (!p_buffer) return;
+
+  Buffer &buffer = *p_buffer;
+
+  buffer.dirty_ranges.clear();
+
+  // same size: the device buffer is kept, only the host side changes
+  // (zero-copy and SVM buffers are tied to their host memory)
+  SVMAllocation allocation;
+
+  if (size == buffer.size &&
+      (buffer.mode == BufferMode::COPY || buffer.mode == BufferMode::PINNED) &&
+      !find_svm_allocation(vector_ref, allocation))
   {
-    cl::array<size_t, 3> origin = {0, 0, 0};
-    cl::array<size_t, 3> region = {(size_t)this->images_2d[id].width,
-                                   (size_t)this->images_2d[id].height,
-                                   1};
+    buffer.vector_ref = vector_ref;
+    return;
+  }
 
-    err = queue.enqueueReadImage(this->images_2d[id].cl_image,
-                                 CL_TRUE,
-                                 origin,
-                                 region,
-                                 0,
-                                 0,
-                                 this->images_2d[id].vector_ref);
-    clerror::throw_opencl_error(err);
+  this->release_buffer(buffer);
+
+  buffer.vector_ref = vector_ref;
+  buffer.size = size;
+
+  this->create_buffer(buffer);
+
+  this->set_buffer_arg(buffer);
+
+  Logger::log()->trace("buffer [{}] reallocated at rebind ({} bytes)",
+                       buffer.id,
+                       size);
+}
+
+void Run::rebind_image_impl(ImageHandle handle,
+                            void       *vector_ref,
+                            size_t      size,
+                            size_t      value_size)
+{
+  Image *p_img = this->get_image(handle);
+  if (!p_img) return;
+
+  Image &img = *p_img;
+
+  // the device image is kept, the host layout must match it
+  size_t channels = channel_count(img.format.image_channel_order);
+
+  if (channel_type_size(img.format.image_channel_data_type) != value_size)
+  {
+    Logger::log()->error("image [{}]: host value type does not match the "
+                         "image format",
+                         img.id);
+    throw std::invalid_argument("image format does not match the host type");
   }
-  else
+
+  if (size < (size_t)img.width * img.height * img.depth * channels *
+                 value_size)
   {
-    Logger::log()->error("unknown 2D imagef id: [{}]", id.c_str());
+    Logger::log()->error("image [{}]: host vector smaller than the image",
+                         img.id);
+    throw std::invalid_argument("host vector smaller than the image");
   }
+
+  img.vector_ref = vector_ref;
+
+  if (this->is_host)
+    this->host_args.set_pointer(img.arg_index, vector_ref, size);
+
+  if (img.direction == Direction::IN) this->write_image(handle);
 }
 
-void Run::write_buffer(const std::string &id)
+void Run::release()
 {
-  if (this->buffers.find(id) != this->buffers.end())
+  // device memory goes back to the pool for the next Run instances
+  for (auto &buffer : this->buffers)
+    this->release_buffer(buffer);
+
+  this->wait_pending();
+
+  for (auto &img : this->images)
+    this->release_image(img);
+
+  if (this->p_runtime)
+    this->p_runtime->release_kernel(this->kernel_name, this->cl_kernel);
+
+  this->buffers.clear();
+  this->images.clear();
+  this->buffer_indices.clear();
+  this->image_indices.clear();
+  this->resources.clear();
+  this->cl_kernel = cl::Kernel();
+  this->p_runtime = nullptr;
+  this->is_pending = false;
+}
+
+void Run::release_buffer(Buffer &buffer)
+{
+  if (buffer.is_mapped)
   {
-    err = this->queue.enqueueWriteBuffer(buffers[id].cl_buffer,
-                                         CL_TRUE,
-                                         0,
-                                         buffers[id].size,
-                                         buffers[id].vector_ref);
-    clerror::throw_opencl_error(err);
+    this->queue.enqueueUnmapMemObject(buffer.cl_buffer, buffer.vector_ref);
+    buffer.is_mapped = false;
+    this->is_pending = true;
   }
-  else
+
+  // the buffer may be handed to another Run as soon as it is in the pool
+  this->wait_pending();
+
+  BufferPool::get_instance().release(buffer.cl_buffer);
+}
+
+void Run::release_image(Image &img)
+{
+  if (img.type == CL_MEM_OBJECT_IMAGE2D && img.cl_image())
   {
-    Logger::log()->error("unknown buffer id: [{}]", id.c_str());
+    this->wait_pending();
+    BufferPool::get_instance().release(cl::Image2D(img.cl_image(), true));
   }
 }
 
-void Run::write_imagef(const std::string &id)
+void Run::wait_pending()
+{
+  // no exception, also used by the destructor
+  if (this->is_pending) this->queue.finish();
+
+  this->is_pending = false;
+}
+
+void Run::set_buffer_arg(Buffer &buffer)
+{
+  if (buffer.mode == BufferMode::HOST)
+  {
+    this->host_args.set_pointer(buffer.arg_index,
+                                buffer.vector_ref,
+                                buffer.size);
+    return;
+  }
+
+  if (is_svm_mode(buffer.mode))
+  {
+    svm_set_kernel_arg(this->cl_kernel, buffer.arg_index, buffer.vector_ref);
+    return;
+  }
+
+  err = this->cl_kernel.setArg(buffer.arg_index, buffer.cl_buffer);
+  clerror::throw_opencl_error(err);
+}
+
+void Run::set_queue(const cl::CommandQueue &new_queue)
+{
+  if (this->is_host) return;
+
+  this->check_context("queue", new_queue.getInfo<CL_QUEUE_CONTEXT>());
+
+  // commands already enqueued on the previous queue
+  if (this->is_pending) this->queue.finish();
+
+  this->queue = new_queue;
+  this->is_pending = false;
+
+  // the queue may be attached to another device
+  this->tuned_generation = 0;
+}
+
+void Run::setup_runtime(KernelManager &runtime)
+{
+  this->p_runtime = &runtime;
+  this->cl_kernel = runtime.checkout_kernel(this->kernel_name);
+  this->queue = runtime.get_queue();
+  this->is_profiling = runtime.is_profiling();
+  this->is_zero_copy = runtime.is_zero_copy();
+  this->is_pinned = runtime.get_zero_copy_mode() == ZeroCopyMode::ALWAYS;
+}
+
+std::vector<cl::Event> Run::unmap_buffers()
 {
-  if (this->images_2d.find(id) != this->images_2d.end())
+  std::vector<cl::Event> events = {};
+
+  for (auto &buffer : this->buffers)
+    if (buffer.mode == BufferMode::SVM_COARSE)
+    {
+      cl::Event cl_event = svm_unmap(this->queue, buffer.vector_ref, nullptr);
+      if (cl_event()) events.push_back(cl_event);
+    }
+    else if (buffer.is_mapped)
+    {
+      cl::Event cl_event;
+
+      err = this->queue.enqueueUnmapMemObject(buffer.cl_buffer,
+                                              buffer.vector_ref,
+                                              nullptr,
+                                              &cl_event);
+      clerror::throw_opencl_error(err);
+
+      buffer.is_mapped = false;
+      events.push_back(cl_event);
+    }
+
+  return events;
+}
+
+std::vector<cl::Event> Run::upload_dirty_ranges()
+{
+  std::vector<cl::Event> events = {};
+
+  for (size_t k = 0; k < this->buffers.size(); k++)
   {
-    cl::array<size_t, 3> origin = {0, 0, 0};
-    cl::array<size_t, 3> region = {(size_t)this->images_2d[id].width,
-                                   (size_t)this->images_2d[id].height,
-                                   1};
+    Buffer &buffer = this->buffers[k];
+
+    if (buffer.dirty_ranges.empty()) continue;
+
+    // zero-copy and SVM data are shared, given back to the device by
+    // unmap_buffers (host backend data are used in place)
+    if (buffer.mode == BufferMode::ZERO_COPY || is_svm_mode(buffer.mode) ||
+        buffer.mode == BufferMode::HOST)
+    {
+      buffer.dirty_ranges.clear();
+      continue;
+    }
+
+    size_t uploaded = 0;
+
+    for (auto &[offset, size] : buffer.dirty_ranges.coalesce())
+    {
+      events.push_back(
+          this->write_buffer_async(BufferHandle{k}, offset, size)
+              .get_event());
+      uploaded += size;
+    }
+
+    buffer.dirty_ranges.clear();
+    this->bytes_saved += buffer.size - uploaded;
+
+    Logger::log()->trace("buffer [{}]: {} / {} bytes uploaded",
+                         buffer.id,
+                         uploaded,
+                         buffer.size);
+  }
+
+  return events;
+}
+
+void Run::write_buffer(const std::string &id)
+{
+  this->write_buffer_async(id).wait();
+}
+
+void Run::write_buffer(BufferHandle handle)
+{
+  this->write_buffer_async(handle).wait();
+}
+
+Event Run::write_buffer_async(const std::string        &id,
+                              const std::vector<Event> &wait_list)
+{
+  return this->write_buffer_async(this->find_buffer(id), wait_list);
+}
+
+Event Run::write_buffer_async(BufferHandle              handle,
+                              const std::vector<Event> &wait_list)
+{
+  Buffer *p_buffer = this->get_buffer(handle);
+  if (!p_buffer) return Event();
+
+  return this->write_buffer_async(handle, 0, p_buffer->size, wait_list);
+}
+
+void Run::write_buffer(const std::string &id, size_t offset, size_t size)
+{
+  this->write_buffer_async(id, offset, size).wait();
+}
+
+void Run::write_buffer(BufferHandle handle, size_t offset, size_t size)
+{
+  this->write_buffer_async(handle, offset, size).wait();
+}
+
+Event Run::write_buffer_async(const std::string        &id,
+                              size_t                    offset,
+                              size_t                    size,
+                              const std::vector<Event> &wait_list)
+{
+  return this->write_buffer_async(this->find_buffer(id),
+                                  offset,
+                                  size,
+                                  wait_list);
+}
+
+Event Run::write_buffer_async(BufferHandle              handle,
+                              size_t                    offset,
+                              size_t                    size,
+                              const std::vector<Event> &wait_list)
+{
+  Buffer *p_buffer = this->get_buffer(handle);
+  if (!p_buffer) return Event();
+
+  Buffer &buffer = *p_buffer;
 
-    err = queue.enqueueWriteImage(this->images_2d[id].cl_image,
-                                  CL_TRUE,
-                                  origin,
-                                  region,
-                                  0,
-                                  0,
-                                  this->images_2d[id].vector_ref);
+  // written so that offset + size can not overflow
+  if (size > buffer.size || offset > buffer.size - size)
+  {
+    Logger::log()->error("buffer [{}]: range of {} bytes at offset {} out of "
+                         "bounds",
+                         buffer.id,
+                         size,
+                         offset);
+    return Event();
+  }
+
+  if (buffer.mode == BufferMode::HOST)
+  {
+    if (offset == 0 && size == buffer.size) buffer.dirty_ranges.clear();
+    return Event();
+  }
+
+  std::vector<cl::Event> cl_wait_list = to_cl_events(wait_list);
+  cl::Event              cl_event;
+
+  const std::vector<cl::Event> *p_wait_list = cl_wait_list.empty()
+                                                  ? nullptr
+                                                  : &cl_wait_list;
+
+  // the explicit transfer supersedes the recorded ranges
+  if (offset == 0 && size == buffer.size) buffer.dirty_ranges.clear();
+
+  if (buffer.mode == BufferMode::SVM_COARSE)
+  {
+    // host data can only be written while the allocation is mapped (after
+    // the allocation or read_buffer), it stays mapped and is given back to
+    // the device at the next launch
+    SVMAllocation allocation;
+
+    if (find_svm_allocation(buffer.vector_ref, allocation) &&
+        !allocation.is_mapped)
+    {
+      Logger::log()->warn("buffer [{}]: SVM data written while owned by the "
+                          "device, read_buffer must be called before "
+                          "modifying them",
+                          buffer.id);
+
+      // best effort, the host content is kept and uploaded at the launch
+      cl_event = svm_map(this->queue,
+                         buffer.vector_ref,
+                         CL_MAP_WRITE_INVALIDATE_REGION,
+                         p_wait_list);
+    }
+    else
+    {
+      err = this->queue.enqueueMarkerWithWaitList(p_wait_list, &cl_event);
+      clerror::throw_opencl_error(err);
+    }
+  }
+  else if (buffer.mode == BufferMode::SVM_FINE)
+  {
+    err = this->queue.enqueueMarkerWithWaitList(p_wait_list, &cl_event);
     clerror::throw_opencl_error(err);
   }
+  else if (buffer.mode == BufferMode::ZERO_COPY)
+  {
+    // map / unmap without reading the device content, the implementation
+    // synchronizes its copy if it has one. The mapped pointer of a
+    // CL_MEM_USE_HOST_PTR buffer is the host pointer
+    void *ptr = buffer.vector_ref;
+
+    if (!buffer.is_mapped)
+    {
+      cl::Event map_event;
+
+      ptr = this->queue.enqueueMapBuffer(buffer.cl_buffer,
+                                         CL_FALSE,
+                                         CL_MAP_WRITE_INVALIDATE_REGION,
+                                         offset,
+                                         size,
+                                         p_wait_list,
+                                         &map_event,
+                                         &err);
+      clerror::throw_opencl_error(err);
+
+      cl_wait_list = {map_event};
+      p_wait_list = &cl_wait_list;
+    }
+
+    err = this->queue.enqueueUnmapMemObject(buffer.cl_buffer,
+                                            ptr,
+                                            p_wait_list,
+                                            &cl_event);
+    clerror::throw_opencl_error(err);
+
+    buffer.is_mapped = false;
+  }
   else
   {
-    Logger::log()->error("unknown 2D imagef id: [{}]", id.c_str());
+    err = this->queue.enqueueWriteBuffer(
+        buffer.cl_buffer,
+        CL_FALSE,
+        offset,
+        size,
+        static_cast<char *>(buffer.vector_ref) + offset,
+        p_wait_list,
+        &cl_event);
+    clerror::throw_opencl_error(err);
   }
+
+  this->is_pending = true;
+  this->queue.flush();
+
+  return Event(cl_event);
+}
+
+void Run::write_image(const std::string &id)
+{
+  this->write_image_async(id).wait();
+}
+
+void Run::write_image(ImageHandle handle)
+{
+  this->write_image_async(handle).wait();
+}
+
+Event Run::write_image_async(const std::string        &id,
+                             const std::vector<Event> &wait_list)
+{
+  return this->write_image_async(this->find_image(id), wait_list);
+}
+
+Event Run::write_image_async(ImageHandle               handle,
+                             const std::vector<Event> &wait_list)
+{
+  Image *p_img = this->get_image(handle);
+  if (!p_img || this->is_host) return Event();
+
+  Image &img = *p_img;
+
+  cl::array<size_t, 3> origin = {0, 0, 0};
+  cl::array<size_t, 3> region = {(size_t)img.width,
+                                 (size_t)img.height,
+                                 (size_t)img.depth};
+
+  std::vector<cl::Event> cl_wait_list = to_cl_events(wait_list);
+  cl::Event              cl_event;
+
+  err = this->queue.enqueueWriteImage(img.cl_image,
+                                      CL_FALSE,
+                                      origin,
+                                      region,
+                                      0,
+                                      0,
+                                      img.vector_ref,
+                                      cl_wait_list.empty() ? nullptr
+                                                           : &cl_wait_list,
+                                      &cl_event);
+  clerror::throw_opencl_error(err);
+
+  this->is_pending = true;
+  this->queue.flush();
+
+  return Event(cl_event);
+}
+
+void Run::write_imagef(const std::string &id)
+{
+  this->write_image(id);
+}
+
+Event Run::write_imagef_async(const std::string        &id,
+                              const std::vector<Event> &wait_list)
+{
+  return this->write_image_async(id, wait_list);
 }
 
 } // namespace clwrapper
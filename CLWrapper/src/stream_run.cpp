@@ -0,0 +1,274 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include "cl_wrapper/autotuner.hpp"
+#include "cl_wrapper/kernel_manager.hpp"
+#include "cl_wrapper/logger.hpp"
+#include "cl_wrapper/stream_run.hpp"
+
+namespace clwrapper
+{
+
+static float helper_sum_execution_times(const std::vector<cl::Event> &events)
+{
+  float sum = 0.f;
+  for (auto &e : events)
+    sum += Event(e).get_timing().get_execution_time();
+  return sum;
+}
+
+StreamRun::StreamRun(const std::string &kernel_name,
+                     size_t             chunk_size,
+                     size_t             buffer_count,
+                     KernelManager     &runtime)
+    : kernel_name(kernel_name), p_runtime(&runtime),
+      chunk_size(std::max((size_t)1, chunk_size))
+{
+  for (size_t k = 0; k < std::max((size_t)1, buffer_count); k++)
+    this->kernels.push_back(runtime.checkout_kernel(kernel_name));
+
+  // device timings are needed to report the overlap
+  cl::Context context = runtime.get_context();
+  cl::Device  device = context.getInfo<CL_CONTEXT_DEVICES>()[0];
+
+  cl::CommandQueue *queues[] = {&this->upload_queue,
+                                &this->compute_queue,
+                                &this->download_queue};
+
+  for (auto p_queue : queues)
+  {
+    *p_queue = cl::CommandQueue(context,
+                                device,
+                                CL_QUEUE_PROFILING_ENABLE,
+                                &err);
+    clerror::throw_opencl_error(err);
+  }
+}
+
+StreamRun::~StreamRun()
+{
+  this->upload_queue.finish();
+  this->compute_queue.finish();
+  this->download_queue.finish();
+
+  this->release_buffers();
+
+  for (auto &kernel : this->kernels)
+    this->p_runtime->release_kernel(this->kernel_name, kernel);
+}
+
+void StreamRun::allocate(size_t unit_count)
+{
+  // chunks are cut at element (1D) or row (2D) boundaries, each of them
+  // must hold the same number of bytes of every buffer
+  for (auto &[id, buffer] : this->buffers)
+    if (buffer.size % unit_count != 0)
+    {
+      Logger::log()->error("streamed buffer [{}] size ({} bytes) is not a "
+                           "multiple of the global range ({})",
+                           id,
+                           buffer.size,
+                           unit_count);
+      throw std::invalid_argument("streamed buffer " + id +
+                                  ": size not a multiple of the global range");
+    }
+
+  this->release_buffers();
+
+  cl::Context context = this->p_runtime->get_context();
+  cl::Device  device = context.getInfo<CL_CONTEXT_DEVICES>()[0];
+  size_t      max_alloc = device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+
+  for (auto &[id, buffer] : this->buffers)
+  {
+    size_t chunk_bytes = this->chunk_size * (buffer.size / unit_count);
+
+    if (chunk_bytes > max_alloc)
+      Logger::log()->warn("streamed buffer [{}] chunk ({} bytes) exceeds the "
+                          "maximum allocation size",
+                          id,
+                          chunk_bytes);
+
+    cl_mem_flags flags = buffer.direction == Direction::IN ? CL_MEM_READ_ONLY
+                                                           : CL_MEM_WRITE_ONLY;
+
+    for (size_t k = 0; k < this->kernels.size(); k++)
+    {
+      cl::Buffer cl_buffer = BufferPool::get_instance().acquire_buffer(
+          context,
+          flags,
+          chunk_bytes,
+          &err);
+      clerror::throw_opencl_error(err);
+
+      err = this->kernels[k].setArg(buffer.arg_index, cl_buffer);
+      clerror::throw_opencl_error(err);
+
+      buffer.cl_buffers.push_back(cl_buffer);
+    }
+  }
+}
+
+void StreamRun::execute(int total_elements)
+{
+  this->execute_chunks((size_t)total_elements, 1, false);
+}
+
+void StreamRun::execute(const std::vector<int> &global_range_2d)
+{
+  this->execute_chunks((size_t)global_range_2d[1],
+                       (size_t)global_range_2d[0],
+                       true);
+}
+
+void StreamRun::execute_chunks(size_t unit_count,
+                               size_t unit_width,
+                               bool   is_2d)
+{
+  if (unit_count == 0) return;
+
+  this->allocate(unit_count);
+
+  size_t n_chunks = (unit_count + this->chunk_size - 1) / this->chunk_size;
+  size_t n_slots = this->kernels.size();
+
+  // last command of each chunk on each queue
+  std::vector<cl::Event> upload_events(n_chunks);
+  std::vector<cl::Event> kernel_events(n_chunks);
+  std::vector<cl::Event> download_events(n_chunks);
+
+  // every transfer, for the statistics
+  std::vector<cl::Event> uploads = {};
+  std::vector<cl::Event> downloads = {};
+
+  auto t0 = std::chrono::high_resolution_clock::now();
+
+  for (size_t c = 0; c < n_chunks; c++)
+  {
+    size_t slot = c % n_slots;
+    size_t u0 = c * this->chunk_size;
+    size_t count = std::min(unit_count, u0 + this->chunk_size) - u0;
+
+    // the slot inputs can be overwritten once the kernel of the previous
+    // chunk using them is done
+    std::vector<cl::Event> upload_wait = {};
+    if (c >= n_slots) upload_wait.push_back(kernel_events[c - n_slots]);
+
+    for (auto &[id, buffer] : this->buffers)
+    {
+      if (buffer.direction != Direction::IN) continue;
+
+      size_t unit_bytes = buffer.size / unit_count;
+
+      err = this->upload_queue.enqueueWriteBuffer(
+          buffer.cl_buffers[slot],
+          CL_FALSE,
+          0,
+          count * unit_bytes,
+          static_cast<char *>(buffer.vector_ref) + u0 * unit_bytes,
+          upload_wait.empty() ? nullptr : &upload_wait,
+          &upload_events[c]);
+      clerror::throw_opencl_error(err);
+
+      uploads.push_back(upload_events[c]);
+    }
+
+    // inputs uploaded and slot outputs downloaded
+    std::vector<cl::Event> kernel_wait = {};
+    if (upload_events[c]()) kernel_wait.push_back(upload_events[c]);
+    if (c >= n_slots && download_events[c - n_slots]())
+      kernel_wait.push_back(download_events[c - n_slots]);
+
+    err = this->kernels[slot].setArg(this->arg_count, (int)count);
+    clerror::throw_opencl_error(err);
+
+    std::vector<size_t> global_size = is_2d ? std::vector<size_t>{unit_width,
+                                                                  count}
+                                            : std::vector<size_t>{count};
+
+    err = this->compute_queue.enqueueNDRangeKernel(
+        this->kernels[slot],
+        cl::NullRange,
+        to_ndrange(Autotuner::pad_global_size(global_size, {})),
+        cl::NullRange,
+        kernel_wait.empty() ? nullptr : &kernel_wait,
+        &kernel_events[c]);
+    clerror::throw_opencl_error(err);
+
+    std::vector<cl::Event> download_wait = {kernel_events[c]};
+
+    for (auto &[id, buffer] : this->buffers)
+    {
+      if (buffer.direction != Direction::OUT) continue;
+
+      size_t unit_bytes = buffer.size / unit_count;
+
+      err = this->download_queue.enqueueReadBuffer(
+          buffer.cl_buffers[slot],
+          CL_FALSE,
+          0,
+          count * unit_bytes,
+          static_cast<char *>(buffer.vector_ref) + u0 * unit_bytes,
+          &download_wait,
+          &download_events[c]);
+      clerror::throw_opencl_error(err);
+
+      downloads.push_back(download_events[c]);
+    }
+
+    this->upload_queue.flush();
+    this->compute_queue.flush();
+    this->download_queue.flush();
+  }
+
+  this->upload_queue.finish();
+  this->compute_queue.finish();
+  this->download_queue.finish();
+
+  auto t1 = std::chrono::high_resolution_clock::now();
+
+  // statistics
+  this->stats.chunks = n_chunks;
+  this->stats.upload_time = helper_sum_execution_times(uploads);
+  this->stats.compute_time = helper_sum_execution_times(kernel_events);
+  this->stats.download_time = helper_sum_execution_times(downloads);
+  this->stats.wall_time =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count() *
+      1e-6f;
+
+  float transfer_time = this->stats.upload_time + this->stats.download_time;
+  float hidden_time = transfer_time + this->stats.compute_time -
+                      this->stats.wall_time;
+
+  this->stats.overlap = transfer_time > 0.f
+                            ? std::clamp(hidden_time / transfer_time, 0.f, 1.f)
+                            : 0.f;
+
+  Logger::log()->trace("stream [{}]: {} chunks, upload: {:.3f} ms, compute: "
+                       "{:.3f} ms, download: {:.3f} ms, wall: {:.3f} ms, "
+                       "overlap: {:.0f}%",
+                       this->kernel_name,
+                       this->stats.chunks,
+                       this->stats.upload_time,
+                       this->stats.compute_time,
+                       this->stats.download_time,
+                       this->stats.wall_time,
+                       100.f * this->stats.overlap);
+}
+
+void StreamRun::release_buffers()
+{
+  for (auto &[id, buffer] : this->buffers)
+  {
+    for (auto &cl_buffer : buffer.cl_buffers)
+      BufferPool::get_instance().release(cl_buffer);
+
+    buffer.cl_buffers.clear();
+  }
+}
+
+} // namespace clwrapper
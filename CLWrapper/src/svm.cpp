@@ -0,0 +1,256 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <cstdio>
+#include <map>
+#include <mutex>
+
+#include "cl_error_lookup.hpp"
+
+#include "cl_wrapper/device_manager.hpp"
+#include "cl_wrapper/kernel_manager.hpp"
+#include "cl_wrapper/logger.hpp"
+#include "cl_wrapper/svm.hpp"
+
+namespace clwrapper
+{
+
+// live SVM allocations, by address (fallback allocations are not listed)
+static std::map<const void *, SVMAllocation> svm_allocations;
+static std::mutex                            svm_mutex;
+
+cl_bitfield get_svm_capabilities(const cl::Device &cl_device)
+{
+#ifdef CLWRAPPER_ENABLE_SVM
+  // 'OpenCL <major>.<minor> <vendor specific>', the query is not valid on
+  // OpenCL 1.x devices
+  int major = 0;
+  int minor = 0;
+
+  std::sscanf(cl_device.getInfo<CL_DEVICE_VERSION>().c_str(),
+              "OpenCL %d.%d",
+              &major,
+              &minor);
+
+  if (major < 2) return 0;
+
+  return cl_device.getInfo<CL_DEVICE_SVM_CAPABILITIES>();
+#else
+  (void)cl_device;
+  return 0;
+#endif
+}
+
+void *svm_alloc(size_t size)
+{
+#ifdef CLWRAPPER_ENABLE_SVM
+  if (size > 0 && !DeviceManager::is_ready())
+  {
+    Logger::log()->warn("SVM allocation of {} bytes: OpenCL not available, "
+                        "using host memory",
+                        size);
+    return AlignedAllocator<char>().allocate(size);
+  }
+
+  KernelManager   &runtime = KernelManager::get_instance();
+  cl::Context      context = runtime.ensure_context();
+  cl::CommandQueue queue = runtime.get_queue();
+  cl_bitfield      caps = get_svm_capabilities(runtime.get_device());
+
+  if (size > 0 && (caps & CL_DEVICE_SVM_COARSE_GRAIN_BUFFER))
+  {
+    bool             is_fine_grain = caps & CL_DEVICE_SVM_FINE_GRAIN_BUFFER;
+    cl_svm_mem_flags flags = CL_MEM_READ_WRITE;
+
+    if (is_fine_grain) flags |= CL_MEM_SVM_FINE_GRAIN_BUFFER;
+
+    void *ptr = clSVMAlloc(context(), flags, size, HOST_PTR_ALIGNMENT);
+
+    if (ptr)
+    {
+      SVMAllocation allocation = {context,
+                                  queue,
+                                  size,
+                                  is_fine_grain,
+                                  false,
+                                  {}};
+
+      // the host fills the data first
+      if (!is_fine_grain)
+      {
+        int err = queue.enqueueMapSVM(
+            ptr,
+            CL_TRUE,
+            CL_MAP_WRITE_INVALIDATE_REGION,
+            size);
+        clerror::throw_opencl_error(err);
+
+        allocation.is_mapped = true;
+      }
+
+      std::lock_guard<std::mutex> lock(svm_mutex);
+      svm_allocations[ptr] = allocation;
+
+      return ptr;
+    }
+
+    Logger::log()->warn("SVM allocation of {} bytes failed, using host memory",
+                        size);
+  }
+  else if (size > 0)
+  {
+    Logger::log()->warn("SVM allocation of {} bytes: SVM not supported by "
+                        "the device, using host memory",
+                        size);
+  }
+#endif
+
+  return AlignedAllocator<char>().allocate(size);
+}
+
+void svm_free(void *ptr) noexcept
+{
+  if (!ptr) return;
+
+  SVMAllocation allocation;
+
+  if (!find_svm_allocation(ptr, allocation))
+  {
+    AlignedAllocator<char>().deallocate(static_cast<char *>(ptr), 0);
+    return;
+  }
+
+#ifdef CLWRAPPER_ENABLE_SVM
+  // commands using the allocation may still be running, only the last one
+  // is waited for (the allocation may be mapped and is unmapped first)
+  std::vector<cl::Event> wait_list = {};
+  if (allocation.last_use()) wait_list.push_back(allocation.last_use);
+
+  cl::Event unmap_event;
+
+  try
+  {
+    unmap_event = svm_unmap(allocation.queue,
+                            ptr,
+                            wait_list.empty() ? nullptr : &wait_list);
+  }
+  catch (const std::exception &e)
+  {
+    Logger::log()->error("SVM free: unmap failed, {}", e.what());
+  }
+
+  if (unmap_event())
+    unmap_event.wait();
+  else if (allocation.last_use())
+    allocation.last_use.wait();
+
+  clSVMFree(allocation.context(), ptr);
+#endif
+
+  std::lock_guard<std::mutex> lock(svm_mutex);
+  svm_allocations.erase(ptr);
+}
+
+bool find_svm_allocation(const void *ptr, SVMAllocation &allocation)
+{
+  std::lock_guard<std::mutex> lock(svm_mutex);
+
+  auto it = svm_allocations.find(ptr);
+  if (it == svm_allocations.end()) return false;
+
+  allocation = it->second;
+  return true;
+}
+
+bool is_svm_pointer(const void *ptr)
+{
+  std::lock_guard<std::mutex> lock(svm_mutex);
+  return svm_allocations.count(ptr) > 0;
+}
+
+cl::Event svm_map(const cl::CommandQueue       &queue,
+                  void                         *ptr,
+                  cl_map_flags                  flags,
+                  const std::vector<cl::Event> *p_wait_list)
+{
+  std::lock_guard<std::mutex> lock(svm_mutex);
+
+  auto it = svm_allocations.find(ptr);
+  if (it == svm_allocations.end() || it->second.is_fine_grain ||
+      it->second.is_mapped)
+    return cl::Event();
+
+  cl::Event cl_event;
+
+#ifdef CLWRAPPER_ENABLE_SVM
+  int err = queue.enqueueMapSVM(ptr,
+                                CL_FALSE,
+                                flags,
+                                it->second.size,
+                                p_wait_list,
+                                &cl_event);
+  clerror::throw_opencl_error(err);
+
+  it->second.last_use = cl_event;
+#else
+  (void)queue;
+  (void)flags;
+  (void)p_wait_list;
+#endif
+
+  it->second.is_mapped = true;
+
+  return cl_event;
+}
+
+cl::Event svm_unmap(const cl::CommandQueue       &queue,
+                    void                         *ptr,
+                    const std::vector<cl::Event> *p_wait_list)
+{
+  std::lock_guard<std::mutex> lock(svm_mutex);
+
+  auto it = svm_allocations.find(ptr);
+  if (it == svm_allocations.end() || it->second.is_fine_grain ||
+      !it->second.is_mapped)
+    return cl::Event();
+
+  cl::Event cl_event;
+
+#ifdef CLWRAPPER_ENABLE_SVM
+  int err = queue.enqueueUnmapSVM(ptr, p_wait_list, &cl_event);
+  clerror::throw_opencl_error(err);
+
+  it->second.last_use = cl_event;
+#else
+  (void)queue;
+  (void)p_wait_list;
+#endif
+
+  it->second.is_mapped = false;
+
+  return cl_event;
+}
+
+void svm_set_last_use(const void *ptr, const cl::Event &event)
+{
+  std::lock_guard<std::mutex> lock(svm_mutex);
+
+  auto it = svm_allocations.find(ptr);
+  if (it != svm_allocations.end()) it->second.last_use = event;
+}
+
+void svm_set_kernel_arg(const cl::Kernel &kernel, cl_uint index, void *ptr)
+{
+#ifdef CLWRAPPER_ENABLE_SVM
+  int err = clSetKernelArgSVMPointer(kernel(), index, ptr);
+  clerror::throw_opencl_error(err);
+#else
+  // SVM allocations only exist with SVM support
+  (void)kernel;
+  (void)index;
+  (void)ptr;
+  clerror::throw_opencl_error(CL_INVALID_OPERATION);
+#endif
+}
+
+} // namespace clwrapper
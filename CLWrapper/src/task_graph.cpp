@@ -0,0 +1,165 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <algorithm>
+
+#include "cl_error_lookup.hpp"
+
+#include "cl_wrapper/kernel_manager.hpp"
+#include "cl_wrapper/logger.hpp"
+#include "cl_wrapper/task_graph.hpp"
+
+namespace clwrapper
+{
+
+static bool helper_contains(const std::vector<const DeviceResource *> &v,
+                            const DeviceResource                      *p)
+{
+  return std::find(v.begin(), v.end(), p) != v.end();
+}
+
+TaskGraph::TaskGraph(size_t fallback_queue_count, KernelManager &runtime)
+{
+  cl::Context context = runtime.get_context();
+  cl::Device  device = context.getInfo<CL_CONTEXT_DEVICES>()[0];
+
+  cl_command_queue_properties properties = runtime.is_profiling()
+                                               ? CL_QUEUE_PROFILING_ENABLE
+                                               : 0;
+
+  int              err = CL_SUCCESS;
+  cl::CommandQueue queue(context,
+                         device,
+                         properties | CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE,
+                         &err);
+
+  if (err == CL_SUCCESS)
+  {
+    this->queues.push_back(queue);
+    this->out_of_order = true;
+    return;
+  }
+
+  Logger::log()->trace("task graph: out-of-order queue not supported, using "
+                       "{} in-order queues",
+                       fallback_queue_count);
+
+  for (size_t k = 0; k < std::max((size_t)1, fallback_queue_count); k++)
+  {
+    this->queues.push_back(cl::CommandQueue(context, device, properties, &err));
+    clerror::throw_opencl_error(err);
+  }
+}
+
+void TaskGraph::add_dependency(size_t task, size_t depends_on)
+{
+  if (task >= this->tasks.size() || depends_on >= task)
+  {
+    Logger::log()->error("task graph: invalid dependency {} -> {}",
+                         depends_on,
+                         task);
+    return;
+  }
+
+  std::vector<size_t> &deps = this->tasks[task].dependencies;
+
+  if (std::find(deps.begin(), deps.end(), depends_on) == deps.end())
+    deps.push_back(depends_on);
+
+  this->tasks[depends_on].is_sink = false;
+}
+
+size_t TaskGraph::add_task(
+    Run                                       &run,
+    const std::vector<int>                    &global_range,
+    const std::vector<const DeviceResource *> &reads,
+    const std::vector<const DeviceResource *> &writes)
+{
+  size_t task = this->tasks.size();
+
+  TaskNode node;
+  node.p_run = &run;
+  node.global_range = global_range;
+  node.reads = reads;
+  node.writes = writes;
+
+  this->tasks.push_back(node);
+
+  // accessed resources, each one only once
+  std::vector<const DeviceResource *> resources = reads;
+  for (auto p : writes)
+    if (!helper_contains(resources, p)) resources.push_back(p);
+
+  for (auto p : resources)
+  {
+    bool is_written = helper_contains(writes, p);
+
+    for (size_t k = task; k-- > 0;)
+    {
+      // last writer (the previous ones are transitively waited for)
+      if (helper_contains(this->tasks[k].writes, p))
+      {
+        this->add_dependency(task, k);
+        break;
+      }
+
+      // write after read
+      if (is_written && helper_contains(this->tasks[k].reads, p))
+        this->add_dependency(task, k);
+    }
+  }
+
+  return task;
+}
+
+void TaskGraph::clear()
+{
+  this->tasks.clear();
+}
+
+void TaskGraph::execute()
+{
+  wait_for_events(this->execute_async());
+}
+
+std::vector<Event> TaskGraph::execute_async()
+{
+  // tasks only depend on previously added ones, the insertion order is a
+  // topological order
+  std::vector<Event> events(this->tasks.size());
+  std::vector<Event> sink_events = {};
+
+  for (size_t k = 0; k < this->tasks.size(); k++)
+  {
+    TaskNode &node = this->tasks[k];
+
+    std::vector<Event> wait_list;
+    for (auto d : node.dependencies)
+      wait_list.push_back(events[d]);
+
+    // host data uploaded by a previous task (on another queue or out of
+    // order), not tracked by the dependencies between readers
+    for (auto p : node.reads)
+      wait_list.push_back(Event(p->get_pending_upload()));
+
+    for (auto p : node.writes)
+      wait_list.push_back(Event(p->get_pending_upload()));
+
+    // several in-order queues: the tasks are spread in turn
+    node.p_run->set_queue(this->queues[k % this->queues.size()]);
+
+    if (node.global_range.size() == 1)
+      events[k] = node.p_run->execute_async(node.global_range[0], wait_list);
+    else
+      events[k] = node.p_run->execute_async(node.global_range, wait_list);
+
+    if (node.is_sink) sink_events.push_back(events[k]);
+  }
+
+  for (auto &queue : this->queues)
+    queue.flush();
+
+  return sink_events;
+}
+
+} // namespace clwrapper
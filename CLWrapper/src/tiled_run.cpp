@@ -0,0 +1,260 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <algorithm>
+
+#include "cl_wrapper/autotuner.hpp"
+#include "cl_wrapper/kernel_manager.hpp"
+#include "cl_wrapper/logger.hpp"
+#include "cl_wrapper/tiled_run.hpp"
+
+namespace clwrapper
+{
+
+// tile size limit (halo included) when not set by the user
+static const int DEFAULT_MAX_TILE_SIZE = 2048;
+
+TiledRun::TiledRun(const std::string &kernel_name,
+                   int                halo,
+                   int                tile_size,
+                   size_t             buffer_count,
+                   KernelManager     &runtime)
+    : kernel_name(kernel_name), p_runtime(&runtime), halo(std::max(0, halo)),
+      buffer_count(std::max((size_t)1, buffer_count))
+{
+  this->cl_kernel = runtime.checkout_kernel(kernel_name);
+
+  cl::Context context = runtime.get_context();
+  cl::Device  device = context.getInfo<CL_CONTEXT_DEVICES>()[0];
+
+  // largest tile fitting in a device image
+  int max_size = (int)std::min(device.getInfo<CL_DEVICE_IMAGE2D_MAX_WIDTH>(),
+                               device.getInfo<CL_DEVICE_IMAGE2D_MAX_HEIGHT>());
+
+  if (tile_size <= 0) max_size = std::min(max_size, DEFAULT_MAX_TILE_SIZE);
+
+  this->tile_size = tile_size > 0 ? std::min(tile_size, max_size - 2 * halo)
+                                  : max_size - 2 * halo;
+
+  if (this->tile_size <= 0)
+    throw std::invalid_argument("halo too large for the device images");
+
+  cl::CommandQueue *queues[] = {&this->upload_queue,
+                                &this->compute_queue,
+                                &this->download_queue};
+
+  for (auto p_queue : queues)
+  {
+    *p_queue = cl::CommandQueue(context, device, 0, &err);
+    clerror::throw_opencl_error(err);
+  }
+}
+
+TiledRun::~TiledRun()
+{
+  this->upload_queue.finish();
+  this->compute_queue.finish();
+  this->download_queue.finish();
+
+  this->release_images();
+
+  this->p_runtime->release_kernel(this->kernel_name, this->cl_kernel);
+}
+
+void TiledRun::bind_imagef(const std::string  &id,
+                           std::vector<float> &vector,
+                           Direction           direction)
+{
+  if (this->extra_arg_count > 0)
+    Logger::log()->error("image [{}] bound after the extra arguments", id);
+
+  auto it = this->images.find(id);
+
+  TiledImage image;
+  image.p_vector = &vector;
+  image.direction = direction;
+  image.arg_index = it != this->images.end() ? it->second.arg_index
+                                             : (int)this->images.size();
+  image.cl_images.resize(this->buffer_count);
+
+  if (it != this->images.end())
+  {
+    for (auto &slot_images : it->second.cl_images)
+      for (auto &[dims, cl_image] : slot_images)
+        BufferPool::get_instance().release(cl_image);
+  }
+
+  this->images[id] = image;
+}
+
+void TiledRun::execute(int width, int height)
+{
+  int nx = (width + this->tile_size - 1) / this->tile_size;
+  int ny = (height + this->tile_size - 1) / this->tile_size;
+  int n_tiles = nx * ny;
+
+  int width_arg = (int)this->images.size();
+
+  std::vector<cl::Event> upload_events(n_tiles);
+  std::vector<cl::Event> kernel_events(n_tiles);
+  std::vector<cl::Event> download_events(n_tiles);
+
+  const size_t row_pitch = width * sizeof(float);
+
+  for (int t = 0; t < n_tiles; t++)
+  {
+    size_t slot = (size_t)t % this->buffer_count;
+
+    // interior
+    int ix0 = (t % nx) * this->tile_size;
+    int iy0 = (t / nx) * this->tile_size;
+    int ix1 = std::min(width, ix0 + this->tile_size);
+    int iy1 = std::min(height, iy0 + this->tile_size);
+
+    // interior and halo, clipped to the raster
+    int tx0 = std::max(0, ix0 - this->halo);
+    int ty0 = std::max(0, iy0 - this->halo);
+    int tw = std::min(width, ix1 + this->halo) - tx0;
+    int th = std::min(height, iy1 + this->halo) - ty0;
+
+    // the slot images are reused once the tile previously using the slot
+    // has been computed (inputs) and downloaded (outputs)
+    std::vector<cl::Event> upload_wait = {};
+    std::vector<cl::Event> kernel_wait = {};
+
+    if (t >= (int)this->buffer_count)
+    {
+      upload_wait.push_back(kernel_events[t - this->buffer_count]);
+      if (download_events[t - this->buffer_count]())
+        kernel_wait.push_back(download_events[t - this->buffer_count]);
+    }
+
+    for (auto &[id, image] : this->images)
+    {
+      cl::Image2D cl_image = this->get_tile_image(image, slot, tw, th);
+
+      err = this->cl_kernel.setArg(image.arg_index, cl_image);
+      clerror::throw_opencl_error(err);
+
+      if (image.direction != Direction::IN) continue;
+
+      // sub-region of the host raster
+      cl::array<size_t, 3> origin = {0, 0, 0};
+      cl::array<size_t, 3> region = {(size_t)tw, (size_t)th, 1};
+
+      err = this->upload_queue.enqueueWriteImage(
+          cl_image,
+          CL_FALSE,
+          origin,
+          region,
+          row_pitch,
+          0,
+          image.p_vector->data() + (size_t)ty0 * width + tx0,
+          upload_wait.empty() ? nullptr : &upload_wait,
+          &upload_events[t]);
+      clerror::throw_opencl_error(err);
+    }
+
+    if (upload_events[t]()) kernel_wait.push_back(upload_events[t]);
+
+    err = this->cl_kernel.setArg(width_arg, tw);
+    clerror::throw_opencl_error(err);
+    err = this->cl_kernel.setArg(width_arg + 1, th);
+    clerror::throw_opencl_error(err);
+
+    std::vector<size_t> global_size = Autotuner::pad_global_size(
+        {(size_t)tw, (size_t)th},
+        {});
+
+    err = this->compute_queue.enqueueNDRangeKernel(
+        this->cl_kernel,
+        cl::NullRange,
+        to_ndrange(global_size),
+        cl::NullRange,
+        kernel_wait.empty() ? nullptr : &kernel_wait,
+        &kernel_events[t]);
+    clerror::throw_opencl_error(err);
+
+    // interior only
+    std::vector<cl::Event> download_wait = {kernel_events[t]};
+
+    for (auto &[id, image] : this->images)
+    {
+      if (image.direction != Direction::OUT) continue;
+
+      cl::array<size_t, 3> origin = {(size_t)(ix0 - tx0),
+                                     (size_t)(iy0 - ty0),
+                                     0};
+      cl::array<size_t, 3> region = {(size_t)(ix1 - ix0),
+                                     (size_t)(iy1 - iy0),
+                                     1};
+
+      err = this->download_queue.enqueueReadImage(
+          this->get_tile_image(image, slot, tw, th),
+          CL_FALSE,
+          origin,
+          region,
+          row_pitch,
+          0,
+          image.p_vector->data() + (size_t)iy0 * width + ix0,
+          &download_wait,
+          &download_events[t]);
+      clerror::throw_opencl_error(err);
+    }
+
+    this->upload_queue.flush();
+    this->compute_queue.flush();
+    this->download_queue.flush();
+  }
+
+  this->upload_queue.finish();
+  this->compute_queue.finish();
+  this->download_queue.finish();
+
+  Logger::log()->trace("tiled run [{}]: {} x {} tiles of {} pixels",
+                       this->kernel_name,
+                       nx,
+                       ny,
+                       this->tile_size);
+}
+
+cl::Image2D TiledRun::get_tile_image(TiledImage &image,
+                                     size_t      slot,
+                                     int         width,
+                                     int         height)
+{
+  auto &slot_images = image.cl_images[slot];
+  auto  it = slot_images.find({width, height});
+
+  if (it != slot_images.end()) return it->second;
+
+  cl_mem_flags flags = image.direction == Direction::IN ? CL_MEM_READ_ONLY
+                                                        : CL_MEM_WRITE_ONLY;
+
+  cl::Image2D cl_image = BufferPool::get_instance().acquire_image2d(
+      this->p_runtime->get_context(),
+      flags,
+      cl::ImageFormat(CL_R, CL_FLOAT),
+      width,
+      height,
+      &err);
+  clerror::throw_opencl_error(err);
+
+  slot_images[{width, height}] = cl_image;
+
+  return cl_image;
+}
+
+void TiledRun::release_images()
+{
+  for (auto &[id, image] : this->images)
+    for (auto &slot_images : image.cl_images)
+    {
+      for (auto &[dims, cl_image] : slot_images)
+        BufferPool::get_instance().release(cl_image);
+
+      slot_images.clear();
+    }
+}
+
+} // namespace clwrapper
@@ -0,0 +1,63 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <algorithm>
+
+#include "cl_wrapper/logger.hpp"
+#include "cl_wrapper/typed_kernel.hpp"
+
+namespace clwrapper
+{
+
+void validate_kernel_signature(const cl::Kernel               &kernel,
+                               const std::string              &kernel_name,
+                               const std::vector<std::string> &type_names)
+{
+  int    err = CL_SUCCESS;
+  size_t arg_count = kernel.getInfo<CL_KERNEL_NUM_ARGS>(&err);
+  clerror::throw_opencl_error(err);
+
+  if (arg_count != type_names.size())
+  {
+    Logger::log()->error("kernel [{}]: {} arguments declared, {} expected",
+                         kernel_name,
+                         type_names.size(),
+                         arg_count);
+    clerror::throw_opencl_error(CL_INVALID_KERNEL_ARGS);
+  }
+
+  for (size_t k = 0; k < arg_count; k++)
+  {
+    std::string name = kernel.getArgInfo<CL_KERNEL_ARG_TYPE_NAME>((cl_uint)k,
+                                                                  &err);
+
+    // only available for programs built with '-cl-kernel-arg-info'
+    if (err == CL_KERNEL_ARG_INFO_NOT_AVAILABLE)
+    {
+      Logger::log()->trace("kernel [{}]: argument types not checked, no "
+                           "argument info",
+                           kernel_name);
+      return;
+    }
+    clerror::throw_opencl_error(err);
+
+    // some implementations pad or null-terminate the name
+    name.erase(std::remove_if(name.begin(),
+                              name.end(),
+                              [](char c) { return c == ' ' || c == '\0'; }),
+               name.end());
+
+    if (name != type_names[k])
+    {
+      Logger::log()->error("kernel [{}]: argument {} is '{}', declared as "
+                           "'{}'",
+                           kernel_name,
+                           k,
+                           name,
+                           type_names[k]);
+      clerror::throw_opencl_error(CL_INVALID_KERNEL_ARGS);
+    }
+  }
+}
+
+} // namespace clwrapper
@@ -0,0 +1,33 @@
+R""(
+kernel void bench_noop(int n)
+{
+}
+
+kernel void bench_args(int a, int b, float c, float d)
+{
+}
+
+kernel void bench_copy_buffer(global float *in, global float *out, int n)
+{
+  const int i = get_global_id(0);
+
+  if (i >= n) return;
+
+  out[i] = in[i];
+}
+
+kernel void bench_copy_image(read_only image2d_t  in,
+                             write_only image2d_t out,
+                             int                  width,
+                             int                  height)
+{
+  const int2 g = {get_global_id(0), get_global_id(1)};
+
+  if (g.x >= width || g.y >= height) return;
+
+  const sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE |
+                            CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+
+  write_imagef(out, g, read_imagef(in, sampler, g));
+}
+)""
@@ -0,0 +1,491 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+// Benchmarks of the wrapper overheads and throughput. Each case is timed on
+// the host (in us) over a number of repetitions, after a few warm-up runs,
+// and the medians and spread are reported as JSON. Given a baseline (a
+// previous output), cases slower than the baseline by more than the
+// tolerance are flagged and the exit code is 1.
+//
+// usage: clwrapper_bench [--repeats N] [--quick] [--device-type cpu|gpu|all]
+//                        [--output file.json] [--baseline file.json]
+//                        [--tolerance 0.1]
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cl_wrapper.hpp"
+#include "cl_wrapper/logger.hpp"
+
+struct Options
+{
+  int            repeats = 20;
+  int            warmup = 3;
+  float          tolerance = 0.1f;
+  bool           is_quick = false;
+  cl_device_type device_type = CL_DEVICE_TYPE_ALL;
+  std::string    output_path = "";
+  std::string    baseline_path = "";
+};
+
+struct Result
+{
+  std::string name;
+  size_t      size; // elements, bytes or pixels depending on the case
+  float       median;
+  float       p25;
+  float       p75;
+  float       min;
+  float       max;
+  float       throughput = 0.f; // MB/s or Mpixel/s, 0 if not relevant
+  float       baseline = 0.f;   // baseline median, 0 if none
+  bool        is_regression = false;
+};
+
+using Clock = std::chrono::high_resolution_clock;
+
+static float elapsed_us(const Clock::time_point &t0)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                              t0)
+             .count() *
+         1e-3f;
+}
+
+static float percentile(const std::vector<float> &sorted, float p)
+{
+  float  x = p * (float)(sorted.size() - 1);
+  size_t i = (size_t)x;
+
+  if (i + 1 >= sorted.size()) return sorted.back();
+
+  return sorted[i] + (x - (float)i) * (sorted[i + 1] - sorted[i]);
+}
+
+// 'fct' runs one repetition and returns its time (us)
+static Result measure(const std::string            &name,
+                      size_t                        size,
+                      const Options                &options,
+                      const std::function<float()> &fct)
+{
+  for (int k = 0; k < options.warmup; k++)
+    fct();
+
+  std::vector<float> samples = {};
+  for (int k = 0; k < options.repeats; k++)
+    samples.push_back(fct());
+
+  std::sort(samples.begin(), samples.end());
+
+  Result result;
+  result.name = name;
+  result.size = size;
+  result.median = percentile(samples, 0.5f);
+  result.p25 = percentile(samples, 0.25f);
+  result.p75 = percentile(samples, 0.75f);
+  result.min = samples.front();
+  result.max = samples.back();
+
+  std::cerr << name << " [" << size << "]: " << result.median << " us\n";
+
+  return result;
+}
+
+// --- benchmark cases
+
+static void bench_overheads(const Options       &options,
+                            std::vector<Result> &results)
+{
+  // kernel checked out from the pool, shared queue
+  results.push_back(measure("run_construction",
+                            1,
+                            options,
+                            []()
+                            {
+                              auto t0 = Clock::now();
+                              {
+                                auto run = clwrapper::Run("bench_noop");
+                              }
+                              return elapsed_us(t0);
+                            }));
+
+  // per argument
+  {
+    auto run = clwrapper::Run("bench_args");
+
+    results.push_back(measure("set_argument",
+                              1,
+                              options,
+                              [&run]()
+                              {
+                                auto t0 = Clock::now();
+                                run.set_argument(0, 1);
+                                run.set_argument(1, 2);
+                                run.set_argument(2, 1.f);
+                                run.set_argument(3, 2.f);
+                                return 0.25f * elapsed_us(t0);
+                              }));
+  }
+
+  // enqueue only, and enqueue until completion
+  {
+    auto run = clwrapper::Run("bench_noop");
+    run.bind_arguments(1);
+
+    results.push_back(measure("execute_dispatch",
+                              1,
+                              options,
+                              [&run]()
+                              {
+                                auto  t0 = Clock::now();
+                                auto  event = run.execute_async(1);
+                                float time = elapsed_us(t0);
+                                event.wait();
+                                return time;
+                              }));
+
+    results.push_back(measure("execute_latency",
+                              1,
+                              options,
+                              [&run]()
+                              {
+                                auto t0 = Clock::now();
+                                run.execute(1);
+                                return elapsed_us(t0);
+                              }));
+  }
+}
+
+static void bench_transfers(const Options       &options,
+                            std::vector<Result> &results)
+{
+  std::vector<size_t> sizes = options.is_quick
+                                  ? std::vector<size_t>{1 << 10, 1 << 20}
+                                  : std::vector<size_t>{1 << 8,
+                                                        1 << 12,
+                                                        1 << 16,
+                                                        1 << 20,
+                                                        1 << 24};
+
+  for (size_t n : sizes)
+  {
+    std::vector<float> in(n, 1.f);
+    std::vector<float> out(n);
+
+    size_t bytes = n * sizeof(float);
+
+    auto run = clwrapper::Run("bench_copy_buffer");
+
+    // rebinding gives the previous buffer back to the pool
+    results.push_back(measure("bind_buffer",
+                              bytes,
+                              options,
+                              [&run, &in]()
+                              {
+                                auto t0 = Clock::now();
+                                run.reset_argcount();
+                                run.bind_buffer<float>("in", in);
+                                return elapsed_us(t0);
+                              }));
+
+    run.reset_argcount();
+    run.bind_buffer<float>("in", in);
+    run.bind_buffer<float>("out", out);
+    run.bind_arguments((int)n);
+
+    Result write = measure("write_buffer",
+                           bytes,
+                           options,
+                           [&run]()
+                           {
+                             auto t0 = Clock::now();
+                             run.write_buffer("in");
+                             return elapsed_us(t0);
+                           });
+    write.throughput = (float)bytes / write.median;
+    results.push_back(write);
+
+    Result read = measure("read_buffer",
+                          bytes,
+                          options,
+                          [&run]()
+                          {
+                            auto t0 = Clock::now();
+                            run.read_buffer("out");
+                            return elapsed_us(t0);
+                          });
+    read.throughput = (float)bytes / read.median;
+    results.push_back(read);
+  }
+}
+
+static void bench_image_vs_buffer(const Options       &options,
+                                  std::vector<Result> &results)
+{
+  std::vector<int> sides = options.is_quick ? std::vector<int>{256, 1024}
+                                            : std::vector<int>{256,
+                                                               1024,
+                                                               2048,
+                                                               4096};
+
+  for (int side : sides)
+  {
+    int    n = side * side;
+    size_t pixels = (size_t)n;
+
+    std::vector<float> in(n, 1.f);
+    std::vector<float> out(n);
+
+    {
+      auto run = clwrapper::Run("bench_copy_buffer");
+      run.bind_buffer<float>("in", in);
+      run.bind_buffer<float>("out", out);
+      run.bind_arguments(n);
+      run.write_buffer("in");
+
+      Result result = measure("copy_kernel_buffer",
+                              pixels,
+                              options,
+                              [&run, n]()
+                              {
+                                auto t0 = Clock::now();
+                                run.execute(n);
+                                return elapsed_us(t0);
+                              });
+      result.throughput = (float)pixels / result.median;
+      results.push_back(result);
+    }
+
+    {
+      auto run = clwrapper::Run("bench_copy_image");
+      run.bind_imagef("in", in, side, side, clwrapper::Direction::IN);
+      run.bind_imagef("out", out, side, side, clwrapper::Direction::OUT);
+      run.bind_arguments(side, side);
+
+      Result result = measure("copy_kernel_image",
+                              pixels,
+                              options,
+                              [&run, side]()
+                              {
+                                // the elapsed time makes the call blocking
+                                float time = 0.f;
+                                auto  t0 = Clock::now();
+                                run.execute({side, side}, &time);
+                                return elapsed_us(t0);
+                              });
+      result.throughput = (float)pixels / result.median;
+      results.push_back(result);
+    }
+  }
+}
+
+// --- JSON output and baseline
+
+static std::string json_escape(const std::string &str)
+{
+  std::string out = "";
+  for (char c : str)
+  {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+// one result per line, read back by read_baseline
+static void write_json(std::ostream              &os,
+                       const std::string         &device_name,
+                       const Options             &options,
+                       const std::vector<Result> &results)
+{
+  os << "{\n";
+  os << "  \"device\": \"" << json_escape(device_name) << "\",\n";
+  os << "  \"repeats\": " << options.repeats << ",\n";
+  os << "  \"unit\": \"us\",\n";
+  os << "  \"results\": [\n";
+
+  for (size_t k = 0; k < results.size(); k++)
+  {
+    const Result &r = results[k];
+
+    os << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size
+       << ", \"median\": " << r.median << ", \"p25\": " << r.p25
+       << ", \"p75\": " << r.p75 << ", \"min\": " << r.min
+       << ", \"max\": " << r.max << ", \"throughput\": " << r.throughput;
+
+    if (r.baseline > 0.f)
+      os << ", \"baseline\": " << r.baseline << ", \"regression\": "
+         << (r.is_regression ? "true" : "false");
+
+    os << "}" << (k + 1 < results.size() ? "," : "") << "\n";
+  }
+
+  os << "  ]\n";
+  os << "}\n";
+}
+
+// raw value of a field in a single line JSON object, without the quotes
+static std::string json_field(const std::string &line, const std::string &key)
+{
+  std::string pattern = "\"" + key + "\": ";
+  size_t      pos = line.find(pattern);
+
+  if (pos == std::string::npos) return "";
+
+  pos += pattern.size();
+
+  if (line[pos] == '"')
+    return line.substr(pos + 1, line.find('"', pos + 1) - pos - 1);
+
+  return line.substr(pos, line.find_first_of(",}", pos) - pos);
+}
+
+// medians by "name/size"
+static std::map<std::string, float> read_baseline(const std::string &path)
+{
+  std::map<std::string, float> medians = {};
+  std::ifstream                file(path);
+
+  if (!file)
+  {
+    std::cerr << "cannot read the baseline: " << path << "\n";
+    return medians;
+  }
+
+  std::string line;
+  while (std::getline(file, line))
+  {
+    std::string name = json_field(line, "name");
+    if (name.empty()) continue;
+
+    std::string key = name + "/" + json_field(line, "size");
+    medians[key] = std::stof(json_field(line, "median"));
+  }
+
+  return medians;
+}
+
+static bool parse_options(int argc, char **argv, Options &options)
+{
+  for (int k = 1; k < argc; k++)
+  {
+    std::string arg = argv[k];
+    bool        has_value = k + 1 < argc;
+
+    if (arg == "--quick")
+      options.is_quick = true;
+    else if (arg == "--repeats" && has_value)
+      options.repeats = std::max(1, std::stoi(argv[++k]));
+    else if (arg == "--tolerance" && has_value)
+      options.tolerance = std::stof(argv[++k]);
+    else if (arg == "--output" && has_value)
+      options.output_path = argv[++k];
+    else if (arg == "--baseline" && has_value)
+      options.baseline_path = argv[++k];
+    else if (arg == "--device-type" && has_value)
+    {
+      std::string type = argv[++k];
+
+      if (type == "cpu")
+        options.device_type = CL_DEVICE_TYPE_CPU;
+      else if (type == "gpu")
+        options.device_type = CL_DEVICE_TYPE_GPU;
+      else if (type != "all")
+        return false;
+    }
+    else
+      return false;
+  }
+
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  Options options;
+
+  if (!parse_options(argc, argv, options))
+  {
+    std::cerr << "usage: clwrapper_bench [--repeats N] [--quick] "
+                 "[--device-type cpu|gpu|all] [--output file.json] "
+                 "[--baseline file.json] [--tolerance 0.1]\n";
+    return 2;
+  }
+
+  // keep the output clean
+  clwrapper::Logger::log()->set_level(spdlog::level::warn);
+
+  // e.g. a CPU implementation such as PoCL, no GPU needed
+  if (options.device_type != CL_DEVICE_TYPE_ALL)
+  {
+    auto &device_manager = clwrapper::DeviceManager::get_instance();
+    device_manager.set_device_type(options.device_type);
+
+    auto devices = device_manager.get_available_devices();
+
+    if (devices.empty() || !device_manager.set_device(devices.begin()->first))
+    {
+      std::cerr << "no OpenCL device of the requested type\n";
+      return 2;
+    }
+  }
+
+  const std::string code =
+#include "kernels.cl"
+      ;
+
+  clwrapper::KernelManager::get_instance().add_kernel(code);
+
+  std::string device_name =
+      clwrapper::DeviceManager::device().getInfo<CL_DEVICE_NAME>();
+
+  std::cerr << "device: " << device_name << "\n";
+
+  std::vector<Result> results = {};
+
+  bench_overheads(options, results);
+  bench_transfers(options, results);
+  bench_image_vs_buffer(options, results);
+
+  // comparison with the baseline
+  int regression_count = 0;
+
+  if (!options.baseline_path.empty())
+  {
+    std::map<std::string, float> baseline = read_baseline(
+        options.baseline_path);
+
+    for (auto &r : results)
+    {
+      auto it = baseline.find(r.name + "/" + std::to_string(r.size));
+      if (it == baseline.end()) continue;
+
+      r.baseline = it->second;
+      r.is_regression = r.median > r.baseline * (1.f + options.tolerance);
+
+      if (r.is_regression)
+      {
+        regression_count++;
+        std::cerr << "REGRESSION " << r.name << " [" << r.size
+                  << "]: " << r.median << " us (baseline: " << r.baseline
+                  << " us)\n";
+      }
+    }
+  }
+
+  if (options.output_path.empty())
+    write_json(std::cout, device_name, options, results);
+  else
+  {
+    std::ofstream file(options.output_path);
+    write_json(file, device_name, options, results);
+  }
+
+  return regression_count > 0 ? 1 : 0;
+}
@@ -0,0 +1,66 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <iostream>
+
+#include "cl_wrapper.hpp"
+
+int main()
+{
+  const std::string code =
+#include "add.cl"
+      ;
+
+  // record the sources without building them, then start the build in the
+  // background
+  clwrapper::KernelManager::get_instance().set_lazy_build(true);
+  clwrapper::KernelManager::get_instance().add_kernel(code);
+
+  std::shared_future<void> build = clwrapper::KernelManager::get_instance()
+                                       .build_program_async();
+
+  // host side setup overlapping with the compilation
+  int                n = 7;
+  std::vector<float> a(n, 1.f);
+  std::vector<float> b(n, 2.f);
+  std::vector<float> c(n); // output
+
+  // build errors are reported through the future
+  try
+  {
+    build.get();
+  }
+  catch (const clwrapper::BuildError &e)
+  {
+    std::cout << "build failed:\n" << e.get_build_log() << "\n";
+    return 1;
+  }
+
+  auto run = clwrapper::Run("add_kernel");
+
+  run.bind_buffer<float>("a", a);
+  run.bind_buffer<float>("b", b);
+  run.bind_buffer<float>("c", c);
+  run.bind_arguments(n);
+  run.write_buffer("a");
+  run.write_buffer("b");
+  run.execute(n);
+  run.read_buffer("c");
+
+  for (auto &v : c)
+    std::cout << v << "\n";
+
+  // an invalid source, the error is carried by the future
+  clwrapper::KernelManager::get_instance().add_kernel("kernel void bad(");
+
+  try
+  {
+    clwrapper::KernelManager::get_instance().build_program_async().get();
+  }
+  catch (const clwrapper::BuildError &e)
+  {
+    std::cout << "expected build error:\n" << e.get_build_log() << "\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,183 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include "cl_wrapper.hpp"
+
+int main()
+{
+  const std::string code =
+#include "add.cl"
+      ;
+
+  clwrapper::KernelManager::get_instance().add_kernel(code);
+
+  auto run = clwrapper::Run("add_kernel");
+
+  int                n = 11;
+  std::vector<float> a(n, 1.f);
+  std::vector<float> b(n, 2.f);
+  std::vector<float> c(n); // output
+
+  run.bind_buffer<float>("a", a);
+  run.bind_buffer<float>("b", b);
+  run.bind_buffer<float>("c", c);
+  run.bind_arguments(n);
+
+  // uploads, kernel and download chained by events, the host thread is
+  // not blocked
+  clwrapper::Event ea = run.write_buffer_async("a");
+  clwrapper::Event eb = run.write_buffer_async("b");
+  clwrapper::Event ek = run.execute_async(n, {ea, eb});
+  clwrapper::Event ec = run.read_buffer_async("c", {ek});
+
+  std::atomic<bool> is_done = false;
+  ec.then([&is_done]() { is_done = true; });
+
+  // ... host side work ...
+
+  ec.wait();
+
+  // the callback may be called slightly after the event completion
+  while (!is_done)
+    std::this_thread::yield();
+
+  std::cout << "callback called\n";
+
+  for (auto &v : c)
+    std::cout << v << "\n";
+
+  // dirty-range tracking, only the modified elements are uploaded before
+  // the next launch
+  {
+    int                m = 1 << 20;
+    std::vector<float> x(m, 1.f);
+    std::vector<float> y(m, 2.f);
+    std::vector<float> z(m);
+
+    auto run_dirty = clwrapper::Run("add_kernel");
+
+    run_dirty.bind_buffer<float>("x", x);
+    run_dirty.bind_buffer<float>("y", y);
+    run_dirty.bind_buffer<float>("z", z);
+    run_dirty.bind_arguments(m);
+
+    run_dirty.write_buffer("x");
+    run_dirty.write_buffer("y");
+    run_dirty.execute(m);
+
+    for (int i = 1000; i < 1010; i++)
+      x[i] = 10.f;
+    x[m - 1] = 10.f;
+
+    run_dirty.mark_dirty("x", 1000 * sizeof(float), 10 * sizeof(float));
+    run_dirty.mark_dirty("x", (m - 1) * sizeof(float), sizeof(float));
+    run_dirty.execute(m);
+    run_dirty.read_buffer("z");
+
+    std::cout << "z[1005]: " << z[1005] << ", z[m - 1]: " << z[m - 1]
+              << " (expected 12)\n";
+    std::cout << "bytes saved: " << run_dirty.get_bytes_saved() << "\n";
+  }
+
+  // handles and rebinding, the host arrays are swapped at each iteration
+  // while the device buffers are reused
+  {
+    std::vector<float> u0(n, 0.f);
+    std::vector<float> u1(n);
+    std::vector<float> d(n, 1.f);
+
+    auto run_iter = clwrapper::Run("add_kernel");
+
+    auto hu = run_iter.bind_buffer<float>("u", u0);
+    auto hd = run_iter.bind_buffer<float>("d", d);
+    auto hv = run_iter.bind_buffer<float>("v", u1);
+    run_iter.bind_arguments(n);
+
+    run_iter.write_buffer(hd);
+
+    std::vector<float> *p_in = &u0;
+    std::vector<float> *p_out = &u1;
+
+    for (int it = 0; it < 4; it++)
+    {
+      run_iter.rebind(hu, *p_in);
+      run_iter.rebind(hv, *p_out);
+
+      run_iter.write_buffer(hu);
+      run_iter.execute(n);
+      run_iter.read_buffer(hv);
+
+      std::swap(p_in, p_out);
+    }
+
+    std::cout << "u[0]: " << (*p_in)[0] << " (expected 4)\n";
+  }
+
+  // shared virtual memory, if enabled at build time and supported by the
+  // device (page-aligned host memory otherwise)
+  {
+    clwrapper::SVMVector<float> x(n, 1.f);
+    clwrapper::SVMVector<float> y(n, 2.f);
+    clwrapper::SVMVector<float> z(n);
+
+    auto run_svm = clwrapper::Run("add_kernel");
+
+    run_svm.bind_buffer<float>("x", x);
+    run_svm.bind_buffer<float>("y", y);
+    run_svm.bind_buffer<float>("z", z);
+    run_svm.bind_arguments(n);
+
+    // SVM pointers are expected whenever the device reports SVM support
+    // (always 0 without the build option)
+    cl::Device device = clwrapper::KernelManager::get_instance().get_device();
+    bool is_svm_available = clwrapper::get_svm_capabilities(device) != 0;
+    bool is_svm_used = clwrapper::is_svm_mode(run_svm.get_buffer_mode("x"));
+
+    switch (run_svm.get_buffer_mode("x"))
+    {
+    case clwrapper::BufferMode::SVM_FINE:
+      std::cout << "SVM path: fine-grained\n";
+      break;
+    case clwrapper::BufferMode::SVM_COARSE:
+      std::cout << "SVM path: coarse-grained\n";
+      break;
+    case clwrapper::BufferMode::ZERO_COPY:
+      std::cout << "SVM path: not available, zero-copy buffers\n";
+      break;
+    default: std::cout << "SVM path: not available, device buffers\n";
+    }
+
+    if (is_svm_used != is_svm_available ||
+        clwrapper::is_svm_pointer(x.data()) != is_svm_available)
+    {
+      std::cout << "unexpected SVM path\n";
+      return 1;
+    }
+
+    run_svm.write_buffer("x");
+    run_svm.write_buffer("y");
+    run_svm.execute(n);
+    run_svm.read_buffer("z");
+
+    std::cout << "SVM: z[0]: " << z[0] << " (expected 3)\n";
+
+    // coarse-grained allocations are owned by the device after a launch,
+    // the host takes them back with read_buffer before modifying them
+    run_svm.read_buffer("x");
+
+    for (auto &v : x)
+      v = 5.f;
+
+    run_svm.write_buffer("x");
+    run_svm.execute(n);
+    run_svm.read_buffer("z");
+
+    std::cout << "SVM: z[0]: " << z[0] << " (expected 7)\n";
+  }
+
+  return 0;
+}
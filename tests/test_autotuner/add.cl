@@ -0,0 +1,13 @@
+R""(
+kernel void add_kernel(global float *A,
+                       global float *B,
+                       global float *C,
+                       const int     n)
+{
+  const uint i = get_global_id(0);
+
+  if (i >= n) return;
+
+  C[i] = A[i] + B[i];
+}
+)""
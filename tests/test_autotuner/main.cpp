@@ -0,0 +1,147 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "cl_wrapper.hpp"
+
+#include "test_check.hpp"
+
+// entries of the tuning file, comments skipped
+static std::vector<std::string> read_entries(const std::string &path)
+{
+  std::vector<std::string> entries = {};
+  std::ifstream            f(path);
+  std::string              line;
+
+  while (std::getline(f, line))
+    if (!line.empty() && line[0] != '#') entries.push_back(line);
+
+  return entries;
+}
+
+// tune, persist and reload cycle
+int main()
+{
+  const std::string code =
+#include "add.cl"
+      ;
+
+  auto &km = clwrapper::KernelManager::get_instance();
+  auto &tuner = clwrapper::Autotuner::get_instance();
+  int   failures = 0;
+
+  km.add_kernel(code);
+
+  const std::string path = (std::filesystem::temp_directory_path() /
+                            "clwrapper_test_tuning.txt")
+                               .string();
+
+  tuner.set_file_path(path);
+  tuner.clear();
+  tuner.set_repeats(1);
+
+  int                n = 1 << 16;
+  std::vector<float> a(n, 1.f);
+  std::vector<float> b(n, 2.f);
+  std::vector<float> c(n);
+
+  auto run = clwrapper::Run("add_kernel");
+
+  run.bind_buffer<float>("a", a);
+  run.bind_buffer<float>("b", b);
+  run.bind_buffer<float>("c", c);
+  run.bind_arguments(n);
+  run.write_buffer("a");
+  run.write_buffer("b");
+
+  // --- tuning disabled, the database is not used
+
+  tuner.set_enabled(false);
+  run.execute(n);
+
+  failures += check(tuner.get_entry_count() == 0 &&
+                        !std::filesystem::exists(path),
+                    "disabled: nothing tuned");
+
+  // --- tuning mode, kernel not declared tunable
+
+  tuner.set_enabled(true);
+  run.execute(n);
+
+  failures += check(tuner.get_entry_count() == 0 &&
+                        !std::filesystem::exists(path),
+                    "not tunable: nothing tuned");
+
+  // --- tuning, the winner is persisted
+
+  tuner.set_tunable("add_kernel");
+  run.execute(n);
+
+  std::vector<std::string> entries = read_entries(path);
+
+  failures += check(tuner.get_entry_count() == 1 && entries.size() == 1 &&
+                        entries[0].rfind("add_kernel@", 0) == 0,
+                    "tuned and persisted: " +
+                        (entries.empty() ? "" : entries[0]));
+
+  // same configuration, not tuned again
+  run.execute(n);
+
+  failures += check(read_entries(path) == entries, "not tuned twice");
+
+  // --- reload, with the local size edited in the file
+
+  std::string key;
+  std::istringstream(entries.empty() ? "" : entries[0]) >> key;
+
+  {
+    std::ofstream f(path, std::ios::trunc);
+    f << key << " 1\n";
+  }
+
+  tuner.set_file_path(path);
+
+  cl::Kernel          kernel = km.checkout_kernel("add_kernel");
+  std::vector<size_t> local_size = tuner.get_local_size("add_kernel",
+                                                        kernel,
+                                                        km.get_queue(),
+                                                        {(size_t)n},
+                                                        {});
+
+  failures += check(tuner.get_entry_count() == 1 && local_size.size() == 1 &&
+                        local_size[0] == 1,
+                    "entry reloaded from the file");
+
+  // the Run picks the reloaded entry up
+  run.execute(n);
+  run.read_buffer("c");
+
+  failures += check(c[0] == 3.f && c[n - 1] == 3.f, "results unchanged");
+
+  // --- disabled again, the entry is not applied
+
+  tuner.set_enabled(false);
+  local_size = tuner.get_local_size("add_kernel",
+                                    kernel,
+                                    km.get_queue(),
+                                    {(size_t)n},
+                                    {});
+
+  failures += check(local_size.empty(), "disabled: left to the driver");
+
+  km.release_kernel("add_kernel", kernel);
+
+  // --- clear
+
+  tuner.clear();
+
+  failures += check(tuner.get_entry_count() == 0 &&
+                        !std::filesystem::exists(path),
+                    "cleared");
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <chrono>
+#include <iostream>
+
+#include "cl_wrapper.hpp"
+
+int main()
+{
+  const std::string code =
+#include "add.cl"
+      ;
+
+  // use a dedicated cache directory and start from an empty cache
+  clwrapper::BinaryCache &cache = clwrapper::BinaryCache::get_instance();
+  cache.set_directory("clwrapper_test_cache");
+  cache.clear();
+
+  // first build is a miss (compiled from sources and stored), the second
+  // one is a hit (loaded from the binary)
+  for (int k = 0; k < 2; k++)
+  {
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    clwrapper::KernelManager::get_instance().add_kernel(code, true);
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::cout << "build " << k << ": "
+              << std::chrono::duration<float, std::milli>(t1 - t0).count()
+              << " ms\n";
+  }
+
+  cache.log_stats();
+
+  // check the cached program is usable
+  auto run = clwrapper::Run("add_kernel");
+
+  int                n = 5;
+  std::vector<float> a(n, 1.f);
+  std::vector<float> b(n, 2.f);
+  std::vector<float> c(n); // output
+
+  run.bind_buffer<float>("a", a);
+  run.bind_buffer<float>("b", b);
+  run.bind_buffer<float>("c", c);
+  run.bind_arguments(n);
+  run.write_buffer("a");
+  run.write_buffer("b");
+  run.execute(n);
+  run.read_buffer("c");
+
+  for (auto &v : c)
+    std::cout << v << "\n";
+
+  return 0;
+}
@@ -0,0 +1,156 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <iostream>
+
+#include "cl_wrapper.hpp"
+
+#include "test_check.hpp"
+
+static void run_add(std::vector<float> &a,
+                    std::vector<float> &b,
+                    std::vector<float> &c)
+{
+  auto run = clwrapper::Run("add_kernel");
+
+  run.bind_buffer<float>("a", a);
+  run.bind_buffer<float>("b", b);
+  run.bind_buffer<float>("c", c);
+  run.bind_arguments((int)a.size());
+  run.write_buffer("a");
+  run.write_buffer("b");
+  run.execute((int)a.size());
+  run.read_buffer("c");
+}
+
+int main()
+{
+  const std::string code =
+#include "add.cl"
+      ;
+
+  auto &km = clwrapper::KernelManager::get_instance();
+  auto &pool = clwrapper::BufferPool::get_instance();
+  int   failures = 0;
+
+  km.add_kernel(code);
+
+  // device buffers only, host data shared with the device are not pooled
+  km.set_zero_copy_mode(clwrapper::ZeroCopyMode::NEVER);
+
+  // --- size classes
+
+  using BP = clwrapper::BufferPool;
+
+  failures += check(BP::size_class(1) == 256 && BP::size_class(256) == 256,
+                    "minimum size class");
+  failures += check(BP::size_class(257) == 320 &&
+                        BP::size_class(1000) == 1024 &&
+                        BP::size_class(1025) == 1280,
+                    "four size classes per power of two");
+
+  bool is_bounded = true;
+
+  for (size_t size = 1; size < (1 << 20); size = size * 3 / 2 + 1)
+  {
+    size_t rounded = BP::size_class(size);
+    is_bounded &= rounded >= size && BP::size_class(rounded) == rounded &&
+                  (size <= 256 || rounded <= size + size / 4);
+  }
+
+  failures += check(is_bounded, "at most 25% overhead, stable classes");
+
+  // --- reuse across Run instances
+
+  pool.trim();
+  pool.reset_stats();
+
+  int                n = 1000;
+  std::vector<float> a(n, 1.f);
+  std::vector<float> b(n, 2.f);
+  std::vector<float> c(n);
+
+  run_add(a, b, c);
+
+  clwrapper::BufferPoolStats s = pool.get_stats();
+
+  failures += check(s.misses == 3 && s.releases == 3 && s.objects_held == 3,
+                    "first Run allocates, its buffers are kept");
+
+  // slightly smaller arrays, same size class
+  std::vector<float> a2(n - 10, 1.f);
+  std::vector<float> b2(n - 10, 2.f);
+  std::vector<float> c2(n - 10);
+
+  run_add(a2, b2, c2);
+
+  s = pool.get_stats();
+
+  failures += check(s.hits == 3 && s.misses == 3,
+                    "second Run reuses the buffers");
+  failures += check(c2[0] == 3.f, "c2[0] = " + std::to_string(c2[0]));
+
+  // --- compatibility of the requests
+
+  pool.trim();
+  pool.reset_stats();
+
+  cl::Context context = km.get_context();
+
+  cl::Buffer buffer = pool.acquire_buffer(context, CL_MEM_READ_WRITE, 1000);
+  cl_mem     raw = buffer();
+
+  pool.release(buffer);
+  buffer = cl::Buffer();
+
+  cl::Buffer same = pool.acquire_buffer(context, CL_MEM_READ_WRITE, 900);
+
+  failures += check(same() == raw, "reused for the same size class");
+
+  pool.release(same);
+  same = cl::Buffer();
+
+  cl::Buffer other_flags = pool.acquire_buffer(context, CL_MEM_READ_ONLY, 900);
+
+  failures += check(other_flags() != raw, "not reused for other flags");
+
+  cl::Buffer other_size = pool.acquire_buffer(context,
+                                              CL_MEM_READ_WRITE,
+                                              4000);
+
+  failures += check(other_size() != raw, "not reused for another size class");
+
+  cl::Context other_context({km.get_device()});
+  cl::Buffer  other_ctx = pool.acquire_buffer(other_context,
+                                             CL_MEM_READ_WRITE,
+                                             900);
+
+  failures += check(other_ctx() != raw, "not reused for another context");
+
+  s = pool.get_stats();
+
+  failures += check(s.hits == 1 && s.misses == 4 && s.objects_held == 1,
+                    "1 hit, 4 misses, 1 object held");
+
+  // --- trim and high-water mark
+
+  pool.trim();
+  s = pool.get_stats();
+
+  failures += check(s.objects_held == 0 && s.bytes_held == 0,
+                    "nothing held after trim");
+
+  pool.set_high_water_mark(1024);
+  pool.release(other_flags); // 1024 bytes, kept
+  pool.release(other_size);  // 4096 bytes, dropped
+
+  s = pool.get_stats();
+
+  failures += check(s.objects_held == 1 && s.bytes_held == 1024 &&
+                        s.drops == 1,
+                    "objects above the high-water mark are dropped");
+
+  pool.log_stats();
+
+  return failures == 0 ? 0 : 1;
+}
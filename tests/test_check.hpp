@@ -0,0 +1,22 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+
+/**
+ * @file test_check.hpp
+ * @author Otto Link (otto.link.bv@gmail.com)
+ * @brief Result check shared by the tests.
+ *
+ * @copyright Copyright (c) 2025
+ */
+#pragma once
+#include <iostream>
+#include <string>
+
+// prints the outcome of a check, returns 1 if it failed (the failures are
+// summed by the test to set its exit code)
+inline int check(bool condition, const std::string &msg)
+{
+  std::cout << (condition ? "ok: " : "FAILED: ") << msg << "\n";
+  return condition ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <iostream>
+
+#include "cl_wrapper.hpp"
+
+int main()
+{
+  const std::string code =
+#include "add.cl"
+      ;
+
+  clwrapper::KernelManager::get_instance().add_kernel(code);
+
+  int n = 9;
+
+  // device-resident arrays, the inputs are uploaded before the first launch
+  clwrapper::DeviceArray<float> a(std::vector<float>(n, 1.f));
+  clwrapper::DeviceArray<float> b(std::vector<float>(n, 2.f));
+  clwrapper::DeviceArray<float> c(n);
+  clwrapper::DeviceArray<float> d(n);
+
+  // c = a + b, then d = c + b: 'c' never goes back to the host
+  {
+    auto run = clwrapper::Run("add_kernel");
+    run.bind_buffer("a", a);
+    run.bind_buffer("b", b);
+    run.bind_buffer("c", c);
+    run.bind_arguments(n);
+    run.execute(n);
+  }
+
+  {
+    auto run = clwrapper::Run("add_kernel");
+    run.bind_buffer("c", c);
+    run.bind_buffer("b", b);
+    run.bind_buffer("d", d);
+    run.bind_arguments(n);
+    run.execute(n);
+  }
+
+  // downloaded on access
+  for (auto &v : d.get_host_data())
+    std::cout << v << "\n";
+
+  return 0;
+}
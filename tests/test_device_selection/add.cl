@@ -4,4 +4,16 @@ kernel void add_kernel(global float *A, global float *B, global float *C)
   const uint n = get_global_id(0);
   C[n] = A[n] + B[n];
 }
+
+kernel void add_kernel_checked(global float *A,
+                               global float *B,
+                               global float *C,
+                               const int     n)
+{
+  const uint i = get_global_id(0);
+
+  if (i >= n) return;
+
+  C[i] = A[i] + B[i];
+}
 )""
@@ -7,13 +7,51 @@
 
 int main()
 {
-  std::map<size_t, std::string> cl_device_map =
-      clwrapper::DeviceManager::get_instance().get_available_devices();
+  std::vector<clwrapper::DeviceInfo> devices =
+      clwrapper::DeviceManager::get_instance().get_devices();
 
   std::cout << "Available devices:\n";
 
-  for (auto &[id, name] : cl_device_map)
-    std::cout << "device: id = " << id << ", name = " << name << "\n";
+  for (auto &info : devices)
+  {
+    const clwrapper::DeviceCapabilities &caps = info.capabilities;
+
+    std::cout << "device: platform = " << info.platform_id
+              << ", index = " << info.device_index << ", name = " << info.name
+              << "\n";
+    std::cout << "  global memory: " << (caps.global_mem_size >> 20)
+              << " MB, max alloc: " << (caps.max_mem_alloc_size >> 20)
+              << " MB, local memory: " << (caps.local_mem_size >> 10)
+              << " KB\n";
+    std::cout << "  max work-group size: " << caps.max_work_group_size
+              << ", images: " << (caps.image_support ? "yes" : "no")
+              << ", fp16: " << (caps.fp16 ? "yes" : "no")
+              << ", fp64: " << (caps.fp64 ? "yes" : "no")
+              << ", unified memory: " << (caps.unified_memory ? "yes" : "no")
+              << "\n";
+    std::cout << "  OpenCL C version: " << caps.get_opencl_c_version()
+              << ", preferred float vector width: "
+              << caps.preferred_vector_width_float << "\n";
+  }
+
+  // --- device ratings, measured once and then read from the ratings file
+
+  for (auto &info : devices)
+  {
+    clwrapper::DeviceRating rating =
+        clwrapper::DeviceRatings::get_instance().get_rating(info.cl_device);
+
+    std::cout << info.name << ": bandwidth = " << rating.bandwidth
+              << " GB/s, compute = " << rating.gflops << " GFLOPS\n";
+  }
+
+  clwrapper::DeviceManager::get_instance().select_device(
+      clwrapper::DeviceSelection::BENCHMARK,
+      clwrapper::WorkloadProfile::MEMORY_BOUND);
+
+  std::cout << "best device for memory bound kernels: "
+            << clwrapper::DeviceManager::device().getInfo<CL_DEVICE_NAME>()
+            << "\n";
 
   // --- execute the same kernel on each device
 
@@ -24,11 +62,12 @@ int main()
   // add the source (will be build for the current or default device)
   clwrapper::KernelManager::get_instance().add_kernel(code);
 
-  for (auto &[id, name] : cl_device_map)
+  for (auto &info : devices)
   {
-    std::cout << "\n\n--- Running kernel on " << name << " ---\n\n";
+    std::cout << "\n\n--- Running kernel on " << info.name << " ---\n\n";
 
-    if (clwrapper::DeviceManager::get_instance().set_device(id))
+    if (clwrapper::DeviceManager::get_instance().set_device(info.platform_id,
+                                                            info.device_index))
     {
       // program needs to be rebuild for the current device
       clwrapper::KernelManager::get_instance().build_program();
@@ -55,5 +94,40 @@ int main()
     }
   }
 
+  // --- split the same kernel across all the devices
+
+  std::cout << "\n\n--- Running kernel on all the devices ---\n\n";
+
+  // the global size of each slice is rounded up, the kernel needs to check
+  // the element index
+  auto run = clwrapper::MultiDeviceRun("add_kernel_checked");
+
+  int                n = 1000;
+  std::vector<float> a(n, 1.f);
+  std::vector<float> b(n, 2.f);
+  std::vector<float> c(n); // output
+
+  run.bind_buffer<float>("a", a, clwrapper::Direction::IN);
+  run.bind_buffer<float>("b", b, clwrapper::Direction::IN);
+  run.bind_buffer<float>("c", c, clwrapper::Direction::OUT);
+  run.bind_arguments(n);
+
+  // the partition adapts to the measured throughput of each device
+  for (int it = 0; it < 4; it++)
+  {
+    run.execute(n);
+
+    std::vector<float> weights =
+        clwrapper::MultiDeviceManager::get_instance().get_weights(
+            "add_kernel_checked");
+
+    std::cout << "weights:";
+    for (auto &w : weights)
+      std::cout << " " << w;
+    std::cout << "\n";
+  }
+
+  std::cout << "c[0] = " << c[0] << ", c[n - 1] = " << c[n - 1] << "\n";
+
   return 0;
 }
@@ -0,0 +1,23 @@
+R""(
+kernel void add_kernel(global float *A,
+                       global float *B,
+                       global float *C,
+                       const int     n)
+{
+  const uint i = get_global_id(0);
+
+  if (i >= n) return;
+
+  C[i] = A[i] + B[i];
+}
+
+kernel void gradient_kernel(global float *out, const int nx, const int ny)
+{
+  const int x = get_global_id(0);
+  const int y = get_global_id(1);
+
+  if (x >= nx || y >= ny) return;
+
+  out[y * nx + x] = (float)x / nx + (float)y / ny;
+}
+)""
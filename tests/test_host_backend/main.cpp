@@ -0,0 +1,140 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <iostream>
+
+#include "cl_wrapper.hpp"
+
+#include "test_check.hpp"
+
+// the same kernels as OpenCL C and as native C++, the native ones are used
+// if OpenCL is not available
+static void run_kernels(std::vector<float> &a,
+                        std::vector<float> &b,
+                        std::vector<float> &c,
+                        std::vector<float> &g,
+                        int                 nx,
+                        int                 ny)
+{
+  int   n = (int)a.size();
+  float time_add = 0.f;
+  float time_gradient = 0.f;
+
+  auto run = clwrapper::Run("add_kernel");
+
+  run.bind_buffer<float>("a", a);
+  run.bind_buffer<float>("b", b);
+  run.bind_buffer<float>("c", c);
+  run.bind_arguments(n);
+
+  run.write_buffer("a");
+  run.write_buffer("b");
+  run.execute(n, &time_add);
+  run.read_buffer("c");
+
+  auto run_gradient = clwrapper::Run("gradient_kernel");
+
+  run_gradient.bind_buffer<float>("g", g);
+  run_gradient.bind_arguments(nx, ny);
+  run_gradient.execute({nx, ny}, &time_gradient);
+  run_gradient.read_buffer("g");
+
+  std::cout << (run.is_host_backend() ? "host" : "OpenCL")
+            << " - add: " << time_add << " ms, gradient: " << time_gradient
+            << " ms, c[0] = " << c[0] << ", g[last] = " << g.back() << "\n";
+}
+
+int main()
+{
+  auto &host = clwrapper::HostBackend::get_instance();
+
+  // chunk kernel, the inner loop is vectorized by the compiler
+  host.add_kernel("add_kernel",
+                  [](const clwrapper::HostRange &range,
+                     const clwrapper::HostArgs  &args)
+                  {
+                    const float *pa = args.buffer<float>(0);
+                    const float *pb = args.buffer<float>(1);
+                    float       *pc = args.buffer<float>(2);
+
+                    for (size_t i = range.begin; i < range.end; i++)
+                      pc[i] = pa[i] + pb[i];
+                  });
+
+  // work-item kernel
+  host.add_kernel_per_item(
+      "gradient_kernel",
+      [](size_t x, size_t y, const clwrapper::HostArgs &args)
+      {
+        int nx = args.value<int>(1);
+        int ny = args.value<int>(2);
+
+        args.buffer<float>(0)[y * nx + x] = (float)x / nx + (float)y / ny;
+      });
+
+  std::cout << "host threads: " << host.get_thread_count() << "\n";
+
+  int                n = 1 << 22;
+  int                nx = 2048;
+  int                ny = 1024;
+  std::vector<float> a(n, 1.f);
+  std::vector<float> b(n, 2.f);
+  std::vector<float> c(n); // output
+  std::vector<float> g(nx * ny);
+
+  // --- OpenCL if available, otherwise host
+
+  if (clwrapper::DeviceManager::is_ready())
+  {
+    const std::string code =
+#include "add.cl"
+        ;
+
+    clwrapper::KernelManager::get_instance().add_kernel(code);
+  }
+
+  run_kernels(a, b, c, g, nx, ny);
+
+  // --- host, for comparison
+
+  host.set_forced(true);
+  run_kernels(a, b, c, g, nx, ny);
+
+  // --- device-resident data cannot be bound to a host kernel
+
+  int failures = 0;
+
+  if (clwrapper::DeviceManager::is_ready())
+  {
+    clwrapper::DeviceArray<float> array(16);
+    clwrapper::DeviceImage        image(4, 4);
+
+    auto run = clwrapper::Run("add_kernel");
+
+    bool is_thrown = false;
+    try
+    {
+      run.bind_buffer("a", array);
+    }
+    catch (const std::invalid_argument &)
+    {
+      is_thrown = true;
+    }
+
+    failures += check(is_thrown, "host backend: DeviceArray rejected");
+
+    is_thrown = false;
+    try
+    {
+      run.bind_imagef("a", image);
+    }
+    catch (const std::invalid_argument &)
+    {
+      is_thrown = true;
+    }
+
+    failures += check(is_thrown, "host backend: DeviceImage rejected");
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+R""(
+kernel void rgba_to_gray(read_only image2d_t  img_rgba,
+                         write_only image2d_t img_gray,
+                         int                  width,
+                         int                  height)
+{
+  const int2 g = {get_global_id(0), get_global_id(1)};
+
+  if (g.x >= width || g.y >= height) return;
+
+  const sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE |
+                            CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+
+  // uint8 channels are normalized to [0, 1]
+  float4 c = read_imagef(img_rgba, sampler, g);
+
+  write_imagef(img_gray, g, 0.299f * c.x + 0.587f * c.y + 0.114f * c.z);
+}
+
+kernel void layer_sum(read_only image2d_array_t layers,
+                      write_only image2d_t      img_sum,
+                      int                       width,
+                      int                       height,
+                      int                       layer_count)
+{
+  const int2 g = {get_global_id(0), get_global_id(1)};
+
+  if (g.x >= width || g.y >= height) return;
+
+  const sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE |
+                            CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+
+  float sum = 0.f;
+
+  for (int k = 0; k < layer_count; k++)
+    sum += read_imagef(layers, sampler, (int4)(g.x, g.y, k, 0)).x;
+
+  write_imagef(img_sum, g, sum);
+}
+)""
@@ -0,0 +1,79 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+#include "cl_wrapper.hpp"
+
+int main()
+{
+  const std::string code =
+#include "kernel.cl"
+      ;
+
+  clwrapper::KernelManager::get_instance().add_kernel(code);
+
+  int width = 64;
+  int height = 48;
+
+  // RGBA 8 bit normalized input, single channel float output
+  {
+    std::vector<uint8_t> rgba(4 * width * height);
+    std::vector<float>   gray(width * height);
+
+    for (size_t k = 0; k < rgba.size(); k++)
+      rgba[k] = (uint8_t)(k % 256);
+
+    auto run = clwrapper::Run("rgba_to_gray");
+    run.bind_image("rgba",
+                   rgba,
+                   width,
+                   height,
+                   clwrapper::Direction::IN,
+                   CL_RGBA);
+    run.bind_image("gray", gray, width, height, clwrapper::Direction::OUT);
+    run.bind_arguments(width, height);
+    run.execute({width, height});
+    run.read_image("gray");
+
+    float error = 0.f;
+    for (size_t k = 0; k < gray.size(); k++)
+    {
+      float ref = (0.299f * rgba[4 * k] + 0.587f * rgba[4 * k + 1] +
+                   0.114f * rgba[4 * k + 2]) /
+                  255.f;
+      error = std::max(error, std::abs(gray[k] - ref));
+    }
+
+    std::cout << "RGBA to gray, max error: " << error << "\n";
+  }
+
+  // 2D image array, layers stored one after the other
+  {
+    int layer_count = 4;
+
+    std::vector<float> layers(width * height * layer_count);
+    std::vector<float> sum(width * height);
+
+    for (size_t k = 0; k < layers.size(); k++)
+      layers[k] = (float)(k / (width * height) + 1);
+
+    auto run = clwrapper::Run("layer_sum");
+    run.bind_image2d_array("layers",
+                           layers,
+                           width,
+                           height,
+                           layer_count,
+                           clwrapper::Direction::IN);
+    run.bind_image("sum", sum, width, height, clwrapper::Direction::OUT);
+    run.bind_arguments(width, height, layer_count);
+    run.execute({width, height});
+    run.read_image("sum");
+
+    std::cout << "layer sum: " << sum[0] << " (expected 10)\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,48 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <iostream>
+
+#include "cl_wrapper.hpp"
+
+int main()
+{
+  const std::string code_add =
+#include "add.cl"
+      ;
+
+  const std::string code_img =
+#include "kernel.cl"
+      ;
+
+  // sources are only recorded, nothing is compiled yet
+  clwrapper::KernelManager::get_instance().set_lazy_build(true);
+  clwrapper::KernelManager::get_instance().add_kernel(code_add);
+  clwrapper::KernelManager::get_instance().add_kernel(code_img);
+
+  // latency critical kernels can be built upfront
+  clwrapper::KernelManager::get_instance().warm_up({"add_kernel"});
+
+  // the module holding 'img_3x3_avg' is never built, this one has already
+  // been built by the warm-up
+  auto run = clwrapper::Run("add_kernel_with_args");
+
+  int                n = 7;
+  std::vector<float> a(n, 1.f);
+  std::vector<float> b(n, 2.f);
+  std::vector<float> c(n); // output
+
+  run.bind_buffer<float>("a", a);
+  run.bind_buffer<float>("b", b);
+  run.bind_buffer<float>("c", c);
+  run.bind_arguments(n, 1.f, 2.f, 1);
+  run.write_buffer("a");
+  run.write_buffer("b");
+  run.execute(n);
+  run.read_buffer("c");
+
+  for (auto &v : c)
+    std::cout << v << "\n";
+
+  return 0;
+}
@@ -0,0 +1,8 @@
+R""(
+kernel void broken_kernel(global float *A, const int n)
+{
+  const uint i = get_global_id(0);
+
+  A[i] = undeclared_variable;
+}
+)""
@@ -0,0 +1,6 @@
+R""(
+static float helper_twice(float x)
+{
+  return 2.f * x;
+}
+)""
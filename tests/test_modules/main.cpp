@@ -0,0 +1,132 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <algorithm>
+#include <iostream>
+
+#include "cl_wrapper.hpp"
+
+#include "test_check.hpp"
+
+static bool add_module(const std::string &code)
+{
+  try
+  {
+    clwrapper::KernelManager::get_instance().add_kernel(code);
+    return true;
+  }
+  catch (const clwrapper::BuildError &e)
+  {
+    std::cout << "build error (expected):\n" << e.get_build_log() << "\n";
+    return false;
+  }
+}
+
+// each source is compiled and linked as its own module, a module failing to
+// build does not prevent the others from being used. Helpers shared by the
+// modules are given as kernel headers
+int main()
+{
+  const std::string code_add =
+#include "add.cl"
+      ;
+
+  const std::string code_broken =
+#include "broken.cl"
+      ;
+
+  const std::string code_scale =
+#include "scale.cl"
+      ;
+
+  const std::string code_helpers =
+#include "helpers.cl"
+      ;
+
+  const std::string code_twice =
+#include "twice.cl"
+      ;
+
+  auto &km = clwrapper::KernelManager::get_instance();
+  int   failures = 0;
+
+  failures += check(add_module(code_add), "module 'add' built");
+  failures += check(!add_module(code_broken), "module 'broken' rejected");
+
+  // the broken module is retried and reported again, the new module is
+  // still built
+  add_module(code_scale);
+
+  // helper defined in a kernel header, compiled in front of every module
+  // (all the modules are rebuilt, the broken one is reported again)
+  km.add_kernel_header(code_helpers);
+  add_module(code_twice);
+
+  failures += check(km.get_module_count() == 4, "4 modules registered");
+
+  auto names = km.get_kernel_names();
+  auto has_name = [&names](const std::string &name)
+  { return std::find(names.begin(), names.end(), name) != names.end(); };
+
+  failures += check(has_name("add_kernel") && has_name("scale_kernel") &&
+                        has_name("twice_kernel"),
+                    "kernels of the valid modules available");
+  failures += check(!has_name("broken_kernel"),
+                    "kernels of the invalid module not available");
+
+  // the valid modules are also linked together (the header helpers are
+  // static, one copy per module)
+  std::string linked_names = km.get_program()
+                                 .getInfo<CL_PROGRAM_KERNEL_NAMES>();
+
+  auto is_linked = [&linked_names](const std::string &name)
+  { return linked_names.find(name) != std::string::npos; };
+
+  failures += check(is_linked("add_kernel") && is_linked("scale_kernel") &&
+                        is_linked("twice_kernel"),
+                    "all-modules program: " + linked_names);
+
+  // kernels of the valid modules run
+  int                n = 11;
+  std::vector<float> a(n, 1.f);
+  std::vector<float> b(n, 2.f);
+  std::vector<float> c(n); // output
+
+  {
+    auto run = clwrapper::Run("add_kernel");
+
+    run.bind_buffer<float>("a", a);
+    run.bind_buffer<float>("b", b);
+    run.bind_buffer<float>("c", c);
+    run.bind_arguments(n);
+    run.write_buffer("a");
+    run.write_buffer("b");
+    run.execute(n);
+    run.read_buffer("c");
+  }
+
+  {
+    auto run = clwrapper::Run("scale_kernel");
+
+    run.bind_buffer<float>("c", c);
+    run.bind_arguments(2.f, n);
+    run.write_buffer("c");
+    run.execute(n);
+    run.read_buffer("c");
+  }
+
+  {
+    auto run = clwrapper::Run("twice_kernel");
+
+    run.bind_buffer<float>("c", c);
+    run.bind_arguments(n);
+    run.write_buffer("c");
+    run.execute(n);
+    run.read_buffer("c");
+  }
+
+  failures += check(c[0] == 12.f && c[n - 1] == 12.f,
+                    "c[0] = " + std::to_string(c[0]) + " (expected 12)");
+
+  return failures == 0 ? 0 : 1;
+}
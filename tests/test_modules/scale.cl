@@ -0,0 +1,10 @@
+R""(
+kernel void scale_kernel(global float *A, const float s, const int n)
+{
+  const uint i = get_global_id(0);
+
+  if (i >= n) return;
+
+  A[i] *= s;
+}
+)""
@@ -0,0 +1,10 @@
+R""(
+kernel void twice_kernel(global float *A, const int n)
+{
+  const uint i = get_global_id(0);
+
+  if (i >= n) return;
+
+  A[i] = helper_twice(A[i]);
+}
+)""
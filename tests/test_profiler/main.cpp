@@ -0,0 +1,130 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <cmath>
+#include <iostream>
+
+#include "cl_wrapper.hpp"
+
+#include "test_check.hpp"
+
+static bool near(float a, float b)
+{
+  return std::abs(a - b) < 1e-3f;
+}
+
+// synthetic sample of 'ms' milliseconds
+static void record_ms(const std::string &name, int ms)
+{
+  clwrapper::EventTiming timing;
+  timing.start = 1;
+  timing.end = 1 + (cl_ulong)ms * 1000000;
+
+  clwrapper::KernelProfiler::get_instance().record(name, timing);
+}
+
+int main()
+{
+  auto &profiler = clwrapper::KernelProfiler::get_instance();
+  int   failures = 0;
+
+  // --- statistics and percentiles, synthetic samples 1 to 100 ms
+
+  profiler.reset();
+
+  for (int k = 1; k <= 100; k++)
+    record_ms("synthetic", k);
+
+  clwrapper::KernelStats s = profiler.get_stats("synthetic");
+
+  failures += check(s.count == 100 && near(s.min, 1.f) && near(s.max, 100.f),
+                    "count, min, max");
+  failures += check(near(s.mean, 50.5f), "mean");
+  failures += check(near(s.p50, 51.f) && near(s.p99, 99.f),
+                    "p50 = " + std::to_string(s.p50) +
+                        ", p99 = " + std::to_string(s.p99));
+
+  // --- window resizing, the newest samples are kept
+
+  profiler.set_window_size(10); // 91 to 100
+
+  s = profiler.get_stats("synthetic");
+  failures += check(s.count == 100 && near(s.p50, 96.f),
+                    "shrunk window, p50 = " + std::to_string(s.p50));
+
+  record_ms("synthetic", 101); // 92 to 101
+
+  s = profiler.get_stats("synthetic");
+  failures += check(near(s.p50, 97.f),
+                    "oldest sample overwritten, p50 = " +
+                        std::to_string(s.p50));
+
+  profiler.set_window_size(20);
+
+  for (int k = 102; k <= 111; k++) // 92 to 111
+    record_ms("synthetic", k);
+
+  s = profiler.get_stats("synthetic");
+  failures += check(near(s.p50, 102.f),
+                    "grown window filled, p50 = " + std::to_string(s.p50));
+
+  record_ms("synthetic", 112); // 93 to 112
+
+  s = profiler.get_stats("synthetic");
+  failures += check(near(s.p50, 103.f) && s.count == 112,
+                    "grown window, oldest sample overwritten, p50 = " +
+                        std::to_string(s.p50));
+
+  profiler.set_window_size(1024);
+
+  // --- actual launches
+
+  const std::string code =
+#include "add.cl"
+      ;
+
+  clwrapper::KernelManager::get_instance().set_profiling(true);
+  clwrapper::KernelManager::get_instance().add_kernel(code);
+
+  int                n = 1 << 16;
+  std::vector<float> a(n, 1.f);
+  std::vector<float> b(n, 2.f);
+  std::vector<float> c(n);
+
+  auto run = clwrapper::Run("add_kernel");
+
+  run.bind_buffer<float>("a", a);
+  run.bind_buffer<float>("b", b);
+  run.bind_buffer<float>("c", c);
+  run.bind_arguments(n);
+  run.write_buffer("a");
+  run.write_buffer("b");
+
+  // blocking launches are recorded before execute returns
+  for (int it = 0; it < 5; it++)
+    run.execute(n);
+
+  s = profiler.get_stats("add_kernel");
+  failures += check(s.count == 5,
+                    "blocking launches recorded: " + std::to_string(s.count));
+
+  // non-blocking launches are recorded once complete
+  for (int it = 0; it < 5; it++)
+    run.execute_async(n);
+
+  profiler.flush();
+
+  s = profiler.get_stats("add_kernel");
+  failures += check(s.count == 10,
+                    "non-blocking launches recorded after flush: " +
+                        std::to_string(s.count));
+  failures += check(s.min > 0.f && s.min <= s.p50 && s.p50 <= s.p99 &&
+                        s.p99 <= s.max,
+                    "min <= p50 <= p99 <= max");
+
+  run.read_buffer("c");
+
+  profiler.log_stats();
+
+  return failures == 0 ? 0 : 1;
+}
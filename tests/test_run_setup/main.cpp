@@ -0,0 +1,120 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <chrono>
+#include <iostream>
+
+#include "cl_wrapper.hpp"
+
+// Run setup cost: creating a queue and a kernel object for each Run (former
+// behavior) vs. pooled kernel objects and a shared queue
+int main()
+{
+  const std::string code =
+#include "add.cl"
+      ;
+
+  clwrapper::KernelManager::get_instance().add_kernel(code);
+
+  const int          iterations = 2000;
+  int                n = 64;
+  std::vector<float> a(n, 1.f);
+  std::vector<float> b(n, 2.f);
+  std::vector<float> c(n); // output
+
+  // --- before: new queue and kernel each time, finish at destruction
+
+  auto t0 = std::chrono::high_resolution_clock::now();
+
+  for (int it = 0; it < iterations; it++)
+  {
+    cl::CommandQueue queue(clwrapper::KernelManager::context(),
+                           clwrapper::DeviceManager::device());
+
+    cl::Kernel kernel(clwrapper::KernelManager::program("add_kernel"),
+                      "add_kernel");
+    kernel.setArg(3, n);
+
+    queue.finish();
+  }
+
+  auto t1 = std::chrono::high_resolution_clock::now();
+
+  // --- after: Run construction
+
+  for (int it = 0; it < iterations; it++)
+  {
+    clwrapper::Run run("add_kernel");
+    run.set_argument(3, n);
+  }
+
+  auto t2 = std::chrono::high_resolution_clock::now();
+
+  float before = std::chrono::duration<float, std::micro>(t1 - t0).count() /
+                 iterations;
+  float after = std::chrono::duration<float, std::micro>(t2 - t1).count() /
+                iterations;
+
+  std::cout << "Run setup, per instance:\n";
+  std::cout << " - new queue + kernel: " << before << " us\n";
+  std::cout << " - pooled Run: " << after << " us\n";
+
+  // check a full run still behaves
+  clwrapper::Run run("add_kernel");
+
+  run.bind_buffer<float>("a", a);
+  run.bind_buffer<float>("b", b);
+  run.bind_buffer<float>("c", c);
+  run.bind_arguments(n);
+  run.write_buffer("a");
+  run.write_buffer("b");
+  run.execute(n);
+  run.read_buffer("c");
+
+  std::cout << "c[0] = " << c[0] << "\n";
+
+  // moved Run, the moved-from instance has nothing left to wait for or to
+  // give back to the pools
+  {
+    clwrapper::Run moved = std::move(run);
+
+    moved.execute(n);
+    moved.read_buffer("c");
+
+    clwrapper::Run other("add_kernel");
+    other = std::move(moved);
+    other.execute(n);
+    other.read_buffer("c");
+  }
+
+  std::cout << "after move: c[0] = " << c[0] << "\n";
+
+  // typed kernel, the signature is checked at creation and unchanged
+  // arguments are not set again
+  clwrapper::DeviceArray<float> da(a);
+  clwrapper::DeviceArray<float> db(b);
+  clwrapper::DeviceArray<float> dc(n);
+
+  da.upload();
+  db.upload();
+
+  clwrapper::Kernel<clwrapper::arg::Buffer<float>,
+                    clwrapper::arg::Buffer<float>,
+                    clwrapper::arg::Buffer<float>,
+                    int>
+      kernel("add_kernel");
+
+  for (int it = 0; it < 10; it++)
+  {
+    kernel.set_args(da.get_buffer(), db.get_buffer(), dc.get_buffer(), n);
+    kernel.execute({(size_t)n});
+  }
+
+  dc.download();
+
+  std::cout << "typed kernel: c[0] = " << dc.get_host_data()[0]
+            << ", skipped setArg calls: " << kernel.get_skipped_count()
+            << "\n";
+
+  return 0;
+}
@@ -0,0 +1,167 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include "cl_wrapper.hpp"
+
+// runs 'add_kernel' and checks the result, returns the number of errors
+static int check_add(const std::string  &kernel_name,
+                     clwrapper::Runtime &runtime,
+                     float               value)
+{
+  int                n = 1000;
+  std::vector<float> a(n, value);
+  std::vector<float> b(n, 1.f);
+  std::vector<float> c(n);
+
+  auto run = clwrapper::Run(kernel_name, runtime);
+
+  run.bind_buffer<float>("a", a);
+  run.bind_buffer<float>("b", b);
+  run.bind_buffer<float>("c", c);
+  run.bind_arguments(n);
+  run.write_buffer("a");
+  run.write_buffer("b");
+  run.execute(n);
+  run.read_buffer("c");
+
+  int errors = 0;
+  for (auto &v : c)
+    if (v != value + 1.f) errors++;
+
+  return errors;
+}
+
+int main()
+{
+  const std::string code =
+#include "add.cl"
+      ;
+
+  const int thread_count = 8;
+  const int iterations = 50;
+
+  std::atomic<int> errors = 0;
+
+  // every device of every platform
+  std::vector<cl::Device> devices = {};
+  {
+    std::vector<cl::Platform> platforms;
+    cl::Platform::get(&platforms);
+
+    for (auto &platform : platforms)
+    {
+      std::vector<cl::Device> platform_devices;
+      platform.getDevices(CL_DEVICE_TYPE_ALL, &platform_devices);
+      devices.insert(devices.end(),
+                     platform_devices.begin(),
+                     platform_devices.end());
+    }
+  }
+
+  // --- one runtime per thread, spread over the devices, the modules are
+  // compiled concurrently
+
+  std::cout << "runtime per thread, " << devices.size() << " device(s)\n";
+
+  {
+    std::vector<std::thread> threads = {};
+
+    for (int t = 0; t < thread_count; t++)
+      threads.push_back(std::thread(
+          [&, t]()
+          {
+            clwrapper::Runtime runtime(devices[t % devices.size()]);
+            runtime.add_kernel(code);
+
+            for (int k = 0; k < iterations; k++)
+              errors += check_add("add_kernel", runtime, (float)(t + k));
+          }));
+
+    for (auto &thread : threads)
+      thread.join();
+  }
+
+  // --- default runtime shared by all the threads, each thread adds its own
+  // module while the others are running kernels
+
+  std::cout << "shared default runtime\n";
+
+  {
+    clwrapper::KernelManager::get_instance().add_kernel(code);
+
+    std::vector<std::thread> threads = {};
+
+    for (int t = 0; t < thread_count; t++)
+      threads.push_back(std::thread(
+          [&, t]()
+          {
+            auto &runtime = clwrapper::KernelManager::get_instance();
+
+            // same kernel under another name
+            std::string name = "add_kernel_" + std::to_string(t);
+            std::string sources = code;
+            sources.replace(sources.find("add_kernel"), 10, name);
+            runtime.add_kernel(sources);
+
+            for (int k = 0; k < iterations; k++)
+            {
+              errors += check_add("add_kernel", runtime, (float)k);
+              errors += check_add(name, runtime, (float)k);
+            }
+          }));
+
+    for (auto &thread : threads)
+      thread.join();
+  }
+
+  // --- device arrays of an independent runtime, they can not be bound to
+  // a Run of another runtime
+
+  std::cout << "device arrays of an independent runtime\n";
+
+  {
+    clwrapper::Runtime runtime(devices[0]);
+    runtime.add_kernel(code);
+
+    int                           n = 1000;
+    clwrapper::DeviceArray<float> a(std::vector<float>(n, 1.f),
+                                    CL_MEM_READ_WRITE,
+                                    runtime);
+    clwrapper::DeviceArray<float> b(std::vector<float>(n, 2.f),
+                                    CL_MEM_READ_WRITE,
+                                    runtime);
+    clwrapper::DeviceArray<float> c(n, CL_MEM_READ_WRITE, runtime);
+
+    auto run = clwrapper::Run("add_kernel", runtime);
+
+    run.bind_buffer("a", a);
+    run.bind_buffer("b", b);
+    run.bind_buffer("c", c);
+    run.bind_arguments(n);
+    run.execute(n);
+
+    for (auto &v : c.get_host_data())
+      if (v != 3.f) errors++;
+
+    auto other = clwrapper::Run("add_kernel");
+
+    try
+    {
+      other.bind_buffer("a", a);
+      std::cout << "runtime mismatch not detected\n";
+      errors++;
+    }
+    catch (const std::invalid_argument &e)
+    {
+      std::cout << "runtime mismatch rejected: " << e.what() << "\n";
+    }
+  }
+
+  std::cout << "errors: " << errors << "\n";
+
+  return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <iostream>
+
+#include "cl_wrapper.hpp"
+
+int main()
+{
+  const std::string code =
+#include "add.cl"
+      ;
+
+  clwrapper::KernelManager::get_instance().add_kernel(code);
+
+  int                n = 1 << 22;
+  std::vector<float> a(n, 1.f);
+  std::vector<float> b(n, 2.f);
+  std::vector<float> c(n); // output
+
+  // chunks of 256k elements, 3 rotating buffer sets. The kernel receives the
+  // chunk size as its last argument ('n' of add_kernel)
+  auto run = clwrapper::StreamRun("add_kernel", 1 << 18, 3);
+
+  run.bind_buffer("a", a, clwrapper::Direction::IN);
+  run.bind_buffer("b", b, clwrapper::Direction::IN);
+  run.bind_buffer("c", c, clwrapper::Direction::OUT);
+
+  run.execute(n);
+
+  clwrapper::StreamStats stats = run.get_stats();
+
+  std::cout << "chunks: " << stats.chunks << "\n";
+  std::cout << "upload: " << stats.upload_time << " ms\n";
+  std::cout << "compute: " << stats.compute_time << " ms\n";
+  std::cout << "download: " << stats.download_time << " ms\n";
+  std::cout << "wall: " << stats.wall_time << " ms\n";
+  std::cout << "overlap: " << 100.f * stats.overlap << "%\n";
+
+  std::cout << "c[0] = " << c[0] << ", c[n - 1] = " << c[n - 1] << "\n";
+
+  // short last chunk
+  int                m = 3 * (1 << 18) + 1000;
+  std::vector<float> d(m, 1.f);
+  std::vector<float> e(m, 2.f);
+  std::vector<float> f(m); // output
+
+  auto run_tail = clwrapper::StreamRun("add_kernel", 1 << 18, 3);
+
+  run_tail.bind_buffer("a", d, clwrapper::Direction::IN);
+  run_tail.bind_buffer("b", e, clwrapper::Direction::IN);
+  run_tail.bind_buffer("c", f, clwrapper::Direction::OUT);
+
+  run_tail.execute(m);
+
+  std::cout << "chunks: " << run_tail.get_stats().chunks << ", f[m - 1] = "
+            << f[m - 1] << "\n";
+
+  // buffer sizes not matching the global range are rejected
+  try
+  {
+    run_tail.execute(m - 1);
+    std::cout << "mismatched size not detected\n";
+    return 1;
+  }
+  catch (const std::invalid_argument &ex)
+  {
+    std::cout << "mismatched size rejected: " << ex.what() << "\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,89 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <iostream>
+
+#include "cl_wrapper.hpp"
+
+#include "test_check.hpp"
+
+int main()
+{
+  const std::string code =
+#include "add.cl"
+      ;
+
+  clwrapper::KernelManager::get_instance().add_kernel(code);
+
+  int n = 9;
+
+  clwrapper::DeviceArray<float> a(std::vector<float>(n, 1.f));
+  clwrapper::DeviceArray<float> b(std::vector<float>(n, 2.f));
+  clwrapper::DeviceArray<float> c(n);
+  clwrapper::DeviceArray<float> d(n);
+  clwrapper::DeviceArray<float> e(n);
+
+  // diamond: c = a + b and d = a + a are independent, e = c + d waits
+  // for both
+  auto run_c = clwrapper::Run("add_kernel");
+  run_c.bind_buffer("a", a);
+  run_c.bind_buffer("b", b);
+  run_c.bind_buffer("c", c);
+  run_c.bind_arguments(n);
+
+  auto run_d = clwrapper::Run("add_kernel");
+  run_d.bind_buffer("a", a);
+  run_d.bind_buffer("a", a);
+  run_d.bind_buffer("d", d);
+  run_d.bind_arguments(n);
+
+  auto run_e = clwrapper::Run("add_kernel");
+  run_e.bind_buffer("c", c);
+  run_e.bind_buffer("d", d);
+  run_e.bind_buffer("e", e);
+  run_e.bind_arguments(n);
+
+  clwrapper::TaskGraph graph;
+
+  graph.add_task(run_c, {n}, {&a, &b}, {&c});
+  graph.add_task(run_d, {n}, {&a}, {&d});
+  graph.add_task(run_e, {n}, {&c, &d}, {&e});
+
+  std::cout << "out-of-order queue: " << graph.is_out_of_order() << "\n";
+
+  for (auto &task : graph.get_tasks())
+    std::cout << "dependencies: " << task.dependencies.size()
+              << ", sink: " << task.is_sink << "\n";
+
+  // only the sink (e) is waited for
+  graph.execute();
+
+  for (auto &v : e.get_host_data())
+    std::cout << v << "\n";
+
+  int failures = 0;
+
+  // two independent readers of freshly edited host data: the upload started
+  // by the first one is waited for by the second one
+  for (auto &v : a.edit_host_data())
+    v = 3.f;
+
+  clwrapper::TaskGraph readers;
+
+  readers.add_task(run_c, {n}, {&a, &b}, {&c});
+  readers.add_task(run_d, {n}, {&a}, {&d});
+
+  failures += check(readers.get_tasks()[1].dependencies.empty(),
+                    "readers: independent tasks");
+
+  readers.execute();
+
+  failures += check(c.get_host_data()[0] == 5.f &&
+                        c.get_host_data()[n - 1] == 5.f,
+                    "readers: first reader");
+  failures += check(d.get_host_data()[0] == 6.f &&
+                        d.get_host_data()[n - 1] == 6.f,
+                    "readers: second reader");
+
+  return failures == 0 ? 0 : 1;
+}
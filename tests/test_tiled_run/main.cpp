@@ -0,0 +1,52 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <cmath>
+#include <iostream>
+
+#include "cl_wrapper.hpp"
+
+int main()
+{
+  const std::string code =
+#include "kernel.cl"
+      ;
+
+  clwrapper::KernelManager::get_instance().add_kernel(code);
+
+  int width = 1000;
+  int height = 700;
+
+  std::vector<float> a(width * height);
+  std::vector<float> b(width * height); // full raster output
+  std::vector<float> c(width * height); // tiled output
+
+  for (size_t k = 0; k < a.size(); k++)
+    a[k] = std::sin(0.01f * (float)k);
+
+  // reference, one image for the whole raster
+  {
+    auto run = clwrapper::Run("img_3x3_avg");
+    run.bind_imagef("a", a, width, height, clwrapper::Direction::IN);
+    run.bind_imagef("b", b, width, height, clwrapper::Direction::OUT);
+    run.bind_arguments(width, height);
+    run.execute({width, height});
+    run.read_imagef("b");
+  }
+
+  // 256 x 256 tiles with a 1 pixel halo (3x3 stencil)
+  {
+    auto run = clwrapper::TiledRun("img_3x3_avg", 1, 256);
+    run.bind_imagef("a", a, clwrapper::Direction::IN);
+    run.bind_imagef("c", c, clwrapper::Direction::OUT);
+    run.execute(width, height);
+  }
+
+  float error = 0.f;
+  for (size_t k = 0; k < b.size(); k++)
+    error = std::max(error, std::abs(b[k] - c[k]));
+
+  std::cout << "max difference tiled / full raster: " << error << "\n";
+
+  return 0;
+}
@@ -0,0 +1,111 @@
+/* Copyright (c) 2025 Otto Link. Distributed under the terms of the GNU General
+ * Public License. The full license is in the file LICENSE, distributed with
+ * this software. */
+#include <iostream>
+
+#include "cl_wrapper.hpp"
+
+#include "test_check.hpp"
+
+static std::string mode_name(clwrapper::BufferMode mode)
+{
+  switch (mode)
+  {
+  case clwrapper::BufferMode::COPY: return "COPY";
+  case clwrapper::BufferMode::ZERO_COPY: return "ZERO_COPY";
+  case clwrapper::BufferMode::PINNED: return "PINNED";
+  default: return "other";
+  }
+}
+
+// buffer modes chosen for aligned (HostVector) and unaligned (std::vector)
+// host data, for each zero-copy mode
+static int test_mode(clwrapper::ZeroCopyMode zero_copy_mode,
+                     const std::string      &label)
+{
+  using clwrapper::BufferMode;
+
+  auto &km = clwrapper::KernelManager::get_instance();
+  int   failures = 0;
+
+  km.set_zero_copy_mode(zero_copy_mode);
+
+  int                          n = 1 << 16;
+  clwrapper::HostVector<float> a(n, 1.f); // page-aligned
+  std::vector<float>           b(n + 1, 2.f);
+  clwrapper::HostVector<float> c(n);
+  std::vector<float>           d(n + 1);
+
+  // a std::vector may be page-aligned by chance
+  bool is_b_aligned = clwrapper::is_host_ptr_aligned(b.data());
+  bool is_d_aligned = clwrapper::is_host_ptr_aligned(d.data());
+
+  {
+    auto run = clwrapper::Run("add_kernel");
+
+    run.bind_buffer<float>("a", a);
+    run.bind_buffer<float>("b", b);
+    run.bind_buffer<float>("c", c);
+    run.bind_arguments(n);
+
+    bool is_zero_copy = km.is_zero_copy();
+
+    BufferMode expected_aligned = is_zero_copy ? BufferMode::ZERO_COPY
+                                               : BufferMode::COPY;
+    BufferMode expected_unaligned = BufferMode::COPY;
+
+    if (is_zero_copy && zero_copy_mode == clwrapper::ZeroCopyMode::ALWAYS)
+      expected_unaligned = BufferMode::PINNED;
+
+    failures += check(run.get_buffer_mode("a") == expected_aligned,
+                      label + ": aligned data, " +
+                          mode_name(run.get_buffer_mode("a")));
+
+    if (!is_b_aligned)
+      failures += check(run.get_buffer_mode("b") == expected_unaligned,
+                        label + ": unaligned data, " +
+                            mode_name(run.get_buffer_mode("b")));
+
+    clwrapper::Event wa = run.write_buffer_async("a");
+    clwrapper::Event wb = run.write_buffer_async("b");
+    clwrapper::Event ex = run.execute_async(n, {wa, wb});
+    clwrapper::Event rc = run.read_buffer_async("c", {ex});
+
+    rc.wait();
+
+    failures += check(c[0] == 3.f && c[n - 1] == 3.f, label + ": results");
+
+    // unaligned output of another size, the previous buffer (still mapped
+    // in zero-copy mode) is released once the commands using it are done
+    run.rebind(run.get_buffer_handle("c"), d);
+    run.execute(n);
+    run.read_buffer("c");
+
+    if (!is_d_aligned)
+      failures += check(run.get_buffer_mode("c") == expected_unaligned,
+                        label + ": unaligned output, " +
+                            mode_name(run.get_buffer_mode("c")));
+
+    failures += check(d[0] == 3.f && d[n - 1] == 3.f,
+                      label + ": results, unaligned output");
+  }
+
+  return failures;
+}
+
+int main()
+{
+  const std::string code =
+#include "add.cl"
+      ;
+
+  clwrapper::KernelManager::get_instance().add_kernel(code);
+
+  int failures = 0;
+
+  failures += test_mode(clwrapper::ZeroCopyMode::AUTO, "AUTO");
+  failures += test_mode(clwrapper::ZeroCopyMode::ALWAYS, "ALWAYS");
+  failures += test_mode(clwrapper::ZeroCopyMode::NEVER, "NEVER");
+
+  return failures == 0 ? 0 : 1;
+}